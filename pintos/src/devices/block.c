@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include "devices/ide.h"
 #include "threads/malloc.h"
+#include "threads/trace.h"
 
 /* A block device. */
 struct block
@@ -121,7 +122,9 @@ void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
   check_sector (block, sector);
+  trace (TRACE_IO_SUBMIT, block->type, sector, 0);
   block->ops->read (block->aux, sector, buffer);
+  trace (TRACE_IO_COMPLETE, block->type, sector, 0);
   block->read_cnt++;
 }
 
@@ -135,10 +138,74 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  trace (TRACE_IO_SUBMIT, block->type, sector, 1);
   block->ops->write (block->aux, sector, buffer);
+  trace (TRACE_IO_COMPLETE, block->type, sector, 1);
   block->write_cnt++;
 }
 
+/* Reads the CNT sectors starting at SECTOR from BLOCK into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  If BLOCK's driver can transfer several sectors with
+   one command, it does, which is much faster than reading the
+   sectors one at a time.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                     void *buffer)
+{
+  if (cnt == 0)
+    return;
+
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  trace (TRACE_IO_SUBMIT, block->type, sector, 0);
+  if (block->ops->read_multiple != NULL)
+    block->ops->read_multiple (block->aux, sector, cnt, buffer);
+  else
+    {
+      size_t i;
+
+      for (i = 0; i < cnt; i++)
+        block->ops->read (block->aux, sector + i,
+                          (uint8_t *) buffer + i * BLOCK_SECTOR_SIZE);
+    }
+  trace (TRACE_IO_COMPLETE, block->type, sector, 0);
+  block->read_cnt += cnt;
+}
+
+/* Writes the CNT sectors starting at SECTOR to BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes, with
+   as few commands as BLOCK's driver allows.  Returns after the
+   block device has acknowledged receiving all of the data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multiple (struct block *block, block_sector_t sector,
+                      size_t cnt, const void *buffer)
+{
+  if (cnt == 0)
+    return;
+
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  trace (TRACE_IO_SUBMIT, block->type, sector, 1);
+  if (block->ops->write_multiple != NULL)
+    block->ops->write_multiple (block->aux, sector, cnt, buffer);
+  else
+    {
+      size_t i;
+
+      for (i = 0; i < cnt; i++)
+        block->ops->write (block->aux, sector + i,
+                           (const uint8_t *) buffer + i * BLOCK_SECTOR_SIZE);
+    }
+  trace (TRACE_IO_COMPLETE, block->type, sector, 1);
+  block->write_cnt += cnt;
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t
 block_size (struct block *block)
@@ -50,6 +50,10 @@
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
 
+/* Most sectors that one READ SECTOR or WRITE SECTOR command can
+   transfer.  (The sector count register holds 0 for this many.) */
+#define MAX_SECTORS_PER_CMD 256
+
 /* An ATA device. */
 struct ata_disk
   {
@@ -73,6 +77,7 @@ struct channel
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
+    bool present[2];                /* Devices that answered at reset. */
   };
 
 /* We support the two "legacy" ATA channels found in a standard PC. */
@@ -81,11 +86,12 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
-static void reset_channel (struct channel *);
+static void start_reset (struct channel *);
+static void finish_reset (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -97,7 +103,14 @@ static void select_device_wait (const struct ata_disk *);
 
 static void interrupt_handler (struct intr_frame *);
 
-/* Initialize the disk subsystem and detect disks. */
+/* Initialize the disk subsystem and detect disks.
+
+   Resetting a channel takes its devices a while, 150 ms or more,
+   so we reset all of the channels at once and then wait for each
+   of them, instead of waiting out one channel's reset before
+   starting the next.  Disks are still identified and registered
+   in channel order, so device names and probe order are
+   unchanged. */
 void
 ide_init (void) 
 {
@@ -141,8 +154,20 @@ ide_init (void)
       /* Register interrupt handler. */
       intr_register_ext (c->irq, interrupt_handler, c->name);
 
-      /* Reset hardware. */
-      reset_channel (c);
+      /* Start resetting hardware. */
+      start_reset (c);
+    }
+
+  /* Give the devices on every channel time to reset. */
+  timer_msleep (150);
+
+  for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
+    {
+      struct channel *c = &channels[chan_no];
+      int dev_no;
+
+      /* Wait for the reset to finish. */
+      finish_reset (c);
 
       /* Distinguish ATA hard disks from other devices. */
       if (check_device_type (&c->devices[0]))
@@ -159,12 +184,11 @@ ide_init (void)
 
 static char *descramble_ata_string (char *, int size);
 
-/* Resets an ATA channel and waits for any devices present on it
-   to finish the reset. */
+/* Starts resetting ATA channel C.  The caller must wait 150 ms
+   before calling finish_reset(). */
 static void
-reset_channel (struct channel *c) 
+start_reset (struct channel *c) 
 {
-  bool present[2];
   int dev_no;
 
   /* The ATA reset sequence depends on which devices are present,
@@ -184,8 +208,8 @@ reset_channel (struct channel *c)
       outb (reg_nsect (c), 0x55);
       outb (reg_lbal (c), 0xaa);
 
-      present[dev_no] = (inb (reg_nsect (c)) == 0x55
-                         && inb (reg_lbal (c)) == 0xaa);
+      c->present[dev_no] = (inb (reg_nsect (c)) == 0x55
+                            && inb (reg_lbal (c)) == 0xaa);
     }
 
   /* Issue soft reset sequence, which selects device 0 as a side effect.
@@ -195,18 +219,23 @@ reset_channel (struct channel *c)
   outb (reg_ctl (c), CTL_SRST);
   timer_usleep (10);
   outb (reg_ctl (c), 0);
+}
 
-  timer_msleep (150);
-
+/* Waits for any devices present on channel C, which
+   start_reset() began resetting at least 150 ms ago, to finish
+   the reset. */
+static void
+finish_reset (struct channel *c) 
+{
   /* Wait for device 0 to clear BSY. */
-  if (present[0]) 
+  if (c->present[0]) 
     {
       select_device (&c->devices[0]);
       wait_while_busy (&c->devices[0]); 
     }
 
   /* Wait for device 1 to clear BSY. */
-  if (present[1])
+  if (c->present[1])
     {
       int i;
 
@@ -337,63 +366,124 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* Reads the CNT sectors starting at SEC_NO from disk D into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Issues one READ SECTOR command for every
+   MAX_SECTORS_PER_CMD sectors.  The disk interrupts when each
+   sector is ready to be read.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                   void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  lock_release (&c->lock);
+  uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+      size_t i;
+
+      lock_acquire (&c->lock);
+      select_sector (d, sec_no, n);
+      issue_pio_command (c, CMD_READ_SECTOR_RETRY);
+      for (i = 0; i < n; i++)
+        {
+          sema_down (&c->completion_wait);
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+          input_sector (c, buffer);
+          buffer += BLOCK_SECTOR_SIZE;
+        }
+      lock_release (&c->lock);
+
+      sec_no += n;
+      cnt -= n;
+    }
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes the CNT sectors starting at SEC_NO to disk D from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Issues one WRITE SECTOR command for every MAX_SECTORS_PER_CMD
+   sectors.  The disk interrupts when it has taken each sector.
+   Returns after the disk has acknowledged receiving all of the
+   data.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+  const uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+      size_t i;
+
+      lock_acquire (&c->lock);
+      select_sector (d, sec_no, n);
+      issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
+      for (i = 0; i < n; i++)
+        {
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk write failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+          output_sector (c, buffer);
+          sema_down (&c->completion_wait);
+          buffer += BLOCK_SECTOR_SIZE;
+        }
+      lock_release (&c->lock);
+
+      sec_no += n;
+      cnt -= n;
+    }
+}
+
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ide_read (void *d_, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multiple (d_, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data. */
+static void
+ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+{
+  ide_write_multiple (d_, sec_no, 1, buffer);
 }
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple
   };
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the number of sectors CNT, which must be
+   between 1 and MAX_SECTORS_PER_CMD, to the disk's sector
+   selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= MAX_SECTORS_PER_CMD);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt == MAX_SECTORS_PER_CMD ? 0 : cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -0,0 +1,255 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/pte.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Local APIC.
+
+   Each CPU has its own local APIC, which delivers interrupts to
+   it, lets it send interprocessor interrupts (IPIs) to other
+   CPUs, and includes a timer.  We use the local APIC only on
+   multiprocessors: external interrupts from devices still go
+   through the 8259A PICs to the bootstrap processor, which also
+   keeps using the 8254 for the system timer, but every other CPU
+   takes its own timer ticks from its local APIC.
+
+   The registers are memory-mapped at the same physical address
+   on every CPU, each CPU seeing its own.  See [IA32-v3a] chapter
+   8 "Advanced Programmable Interrupt Controller (APIC)". */
+
+/* Virtual address at which we map the local APIC registers.
+   The usual physical address 0xfee00000 is too high to appear in
+   the kernel's mapping of physical memory at PHYS_BASE, so we
+   map the registers separately, at the top of the address
+   space. */
+#define LAPIC_VADDR ((volatile uint32_t *) 0xfffff000)
+
+/* Register offsets, in bytes. */
+#define LAPIC_ID       0x020    /* Local APIC ID. */
+#define LAPIC_TPR      0x080    /* Task Priority. */
+#define LAPIC_EOI      0x0b0    /* End of Interrupt. */
+#define LAPIC_SVR      0x0f0    /* Spurious Interrupt Vector. */
+#define LAPIC_ESR      0x280    /* Error Status. */
+#define LAPIC_ICR_LO   0x300    /* Interrupt Command, bits 0...31. */
+#define LAPIC_ICR_HI   0x310    /* Interrupt Command, bits 32...63. */
+#define LAPIC_TIMER    0x320    /* LVT Timer. */
+#define LAPIC_LINT0    0x350    /* LVT LINT0. */
+#define LAPIC_LINT1    0x360    /* LVT LINT1. */
+#define LAPIC_ERROR    0x370    /* LVT Error. */
+#define LAPIC_TICR     0x380    /* Timer Initial Count. */
+#define LAPIC_TCCR     0x390    /* Timer Current Count. */
+#define LAPIC_TDCR     0x3e0    /* Timer Divide Configuration. */
+
+/* Register bits. */
+#define SVR_ENABLE     0x100    /* APIC software enable. */
+#define LVT_MASKED     0x10000  /* Interrupt masked. */
+#define LVT_PERIODIC   0x20000  /* Timer mode: periodic. */
+#define TDCR_DIV1      0xb      /* Timer divides bus clock by 1. */
+#define ICR_INIT       0x500    /* Delivery mode: INIT. */
+#define ICR_STARTUP    0x600    /* Delivery mode: STARTUP. */
+#define ICR_PENDING    0x1000   /* Delivery status: send pending. */
+#define ICR_ASSERT     0x4000   /* Level: assert. */
+#define ICR_LEVEL      0x8000   /* Trigger mode: level. */
+
+/* Number of PIT ticks over which to calibrate the APIC timer. */
+#define CALIBRATE_TICKS 10
+
+/* APIC timer counts per timer tick.
+   Initialized by lapic_init(). */
+static uint32_t counts_per_tick;
+
+static intr_handler_func lapic_timer_interrupt;
+static intr_handler_func lapic_wakeup_interrupt;
+static void map_registers (uintptr_t paddr);
+static void enable (void);
+static void calibrate (void);
+
+/* Returns local APIC register REG. */
+static inline uint32_t
+lapic_read (int reg)
+{
+  return LAPIC_VADDR[reg / sizeof (uint32_t)];
+}
+
+/* Sets local APIC register REG to VALUE. */
+static inline void
+lapic_write (int reg, uint32_t value)
+{
+  LAPIC_VADDR[reg / sizeof (uint32_t)] = value;
+}
+
+/* Maps the local APIC registers, found at physical address
+   PADDR, enables the bootstrap processor's local APIC, and
+   measures the APIC timer's rate against the 8254 so that the
+   other CPUs can tick at TIMER_FREQ.  Interrupts must be on. */
+void
+lapic_init (uintptr_t paddr)
+{
+  ASSERT (intr_get_level () == INTR_ON);
+
+  map_registers (paddr);
+  intr_register_ext (LAPIC_VEC_TIMER, lapic_timer_interrupt, "APIC Timer");
+  intr_register_ext (LAPIC_VEC_WAKEUP, lapic_wakeup_interrupt,
+                     "APIC Wakeup");
+  enable ();
+  calibrate ();
+}
+
+/* Enables the local APIC of the calling application processor
+   and starts its timer.  Must be called with interrupts off,
+   after lapic_init() has been called on the bootstrap
+   processor. */
+void
+lapic_init_ap (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (counts_per_tick != 0);
+
+  /* Only the bootstrap processor takes interrupts from the
+     8259A. */
+  lapic_write (LAPIC_LINT0, LVT_MASKED);
+  lapic_write (LAPIC_LINT1, LVT_MASKED);
+  enable ();
+
+  lapic_write (LAPIC_TDCR, TDCR_DIV1);
+  lapic_write (LAPIC_TIMER, LVT_PERIODIC | LAPIC_VEC_TIMER);
+  lapic_write (LAPIC_TICR, counts_per_tick / profile_intrs_per_tick ());
+}
+
+/* Returns the local APIC ID of the calling CPU. */
+uint8_t
+lapic_id (void)
+{
+  return lapic_read (LAPIC_ID) >> 24;
+}
+
+/* Signals the end of the interrupt being handled. */
+void
+lapic_eoi (void)
+{
+  lapic_write (LAPIC_EOI, 0);
+}
+
+/* Sends interrupt command LO to the CPU with local APIC ID
+   APIC_ID and waits for it to be accepted. */
+static void
+send_command (uint8_t apic_id, uint32_t lo)
+{
+  lapic_write (LAPIC_ICR_HI, (uint32_t) apic_id << 24);
+  lapic_write (LAPIC_ICR_LO, lo);
+  while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+    continue;
+}
+
+/* Starts the application processor with local APIC ID APIC_ID
+   executing real-mode code at physical address PADDR, which
+   must be page-aligned and below 1 MB.  This is the "universal
+   startup algorithm" of [MP] appendix B.4. */
+void
+lapic_start_ap (uint8_t apic_id, uintptr_t paddr)
+{
+  int i;
+
+  ASSERT (paddr % PGSIZE == 0 && paddr < 0x100000);
+
+  send_command (apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+  timer_udelay (200);
+  send_command (apic_id, ICR_INIT | ICR_LEVEL);
+  timer_mdelay (10);
+
+  for (i = 0; i < 2; i++)
+    {
+      send_command (apic_id, ICR_STARTUP | (paddr >> PGBITS));
+      timer_udelay (200);
+    }
+}
+
+/* Sends interrupt VEC to the CPU with local APIC ID APIC_ID. */
+void
+lapic_send_ipi (uint8_t apic_id, uint8_t vec)
+{
+  send_command (apic_id, vec);
+}
+
+/* Maps the page of local APIC registers at physical address
+   PADDR into init_page_dir at LAPIC_VADDR, with caching
+   disabled.  Page directories created later copy the mapping
+   from init_page_dir. */
+static void
+map_registers (uintptr_t paddr)
+{
+  uint32_t *pde = &init_page_dir[pd_no ((void *) LAPIC_VADDR)];
+  uint32_t *pt;
+
+  ASSERT (paddr % PGSIZE == 0);
+
+  if (*pde == 0)
+    *pde = pde_create (palloc_get_page (PAL_ASSERT | PAL_ZERO));
+  pt = pde_get_pt (*pde);
+  pt[pt_no ((void *) LAPIC_VADDR)]
+    = paddr | PTE_PCD | PTE_PWT | PTE_W | PTE_P;
+
+  /* Flush the TLB. */
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)) : "memory");
+}
+
+/* Software-enables the calling CPU's local APIC and lets it
+   accept interrupts of every priority. */
+static void
+enable (void)
+{
+  lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_VEC_SPURIOUS);
+  lapic_write (LAPIC_ERROR, LVT_MASKED);
+  lapic_write (LAPIC_ESR, 0);
+  lapic_write (LAPIC_TPR, 0);
+  lapic_eoi ();
+}
+
+/* Counts how far the APIC timer of the calling CPU runs down
+   over CALIBRATE_TICKS 8254 timer ticks, and sets
+   counts_per_tick accordingly. */
+static void
+calibrate (void)
+{
+  int64_t start;
+
+  lapic_write (LAPIC_TDCR, TDCR_DIV1);
+  lapic_write (LAPIC_TIMER, LVT_MASKED);
+
+  /* Start counting at a tick boundary. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+
+  lapic_write (LAPIC_TICR, UINT32_MAX);
+  start = timer_ticks ();
+  while (timer_elapsed (start) < CALIBRATE_TICKS)
+    continue;
+  counts_per_tick = (UINT32_MAX - lapic_read (LAPIC_TCCR)) / CALIBRATE_TICKS;
+  lapic_write (LAPIC_TICR, 0);
+
+  ASSERT (counts_per_tick != 0);
+}
+
+/* APIC timer interrupt handler, for CPUs other than the
+   bootstrap processor. */
+static void
+lapic_timer_interrupt (struct intr_frame *args)
+{
+  if (profile_timer_interrupt (args))
+    thread_tick ();
+}
+
+/* Wakeup interrupt handler.  There is nothing to do: the idle
+   thread that was interrupted will look for work on its own. */
+static void
+lapic_wakeup_interrupt (struct intr_frame *args UNUSED)
+{
+}
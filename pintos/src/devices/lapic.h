@@ -0,0 +1,20 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdint.h>
+
+/* Interrupt vectors used by the local APIC.  Vectors from
+   LAPIC_VEC_TIMER up to but not including LAPIC_VEC_SPURIOUS
+   are handled as external interrupts (see interrupt.c). */
+#define LAPIC_VEC_TIMER    0xf0 /* Per-CPU timer tick. */
+#define LAPIC_VEC_WAKEUP   0xf1 /* Wake up an idle CPU. */
+#define LAPIC_VEC_SPURIOUS 0xff /* Spurious interrupt. */
+
+void lapic_init (uintptr_t paddr);
+void lapic_init_ap (void);
+uint8_t lapic_id (void);
+void lapic_eoi (void);
+void lapic_start_ap (uint8_t apic_id, uintptr_t paddr);
+void lapic_send_ipi (uint8_t apic_id, uint8_t vec);
+
+#endif /* devices/lapic.h */
@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
 #include "devices/input.h"
-#include "devices/intq.h"
+#include "devices/spscq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -51,11 +51,27 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Data to be transmitted.
+   The producer is whichever thread holds the console lock and
+   calls serial_putbuf(); it adds bytes without disabling
+   interrupts.  The consumer is serial_interrupt() or, with
+   interrupts off, serial_flush() and putc_queue(). */
+static struct spscq txq;
 
+/* True while a thread is adding bytes to TXQ in
+   serial_putbuf().  Output produced meanwhile by an interrupt
+   handler that preempted that thread, or by another CPU, is sent
+   by polling instead of being queued, to keep TXQ
+   single-producer.  Claimed with claim_producer(). */
+static volatile bool tx_producing;
+
+/* Thread waiting in serial_putbuf() for room in TXQ, if any. */
+static struct thread *tx_waiter;
+
+static bool claim_producer (void);
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void putc_queue (uint8_t);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -71,7 +87,7 @@ init_poll (void)
   outb (FCR_REG, 0);                    /* Disable FIFO. */
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  spscq_init (&txq);
   mode = POLL;
 } 
 
@@ -98,35 +114,86 @@ serial_init_queue (void)
 void
 serial_putc (uint8_t byte) 
 {
-  enum intr_level old_level = intr_disable ();
+  serial_putbuf (&byte, 1);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port.
+
+   In thread context with interrupts on, the bytes are added to
+   the transmit queue in bulk, without disabling interrupts;
+   interrupts are turned off only to kick the transmitter and,
+   if the queue fills up, to wait for the interrupt handler to
+   drain it.  Otherwise, the bytes are sent one at a time with
+   interrupts off.
 
-  if (mode != QUEUE)
+   Only one thread at a time may add to the transmit queue, so
+   threads must serialize their calls, as the console lock
+   does. */
+void
+serial_putbuf (const void *buffer, size_t size) 
+{
+  const uint8_t *p = buffer;
+  enum intr_level old_level;
+
+  if (mode != QUEUE || intr_context () || intr_get_level () == INTR_OFF
+      || !claim_producer ())
     {
-      /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
-      if (mode == UNINIT)
-        init_poll ();
-      putc_poll (byte); 
+      old_level = intr_disable ();
+      while (size-- > 0)
+        {
+          if (mode != QUEUE)
+            {
+              /* If we're not set up for interrupt-driven I/O
+                 yet, use dumb polling to transmit a byte. */
+              if (mode == UNINIT)
+                init_poll ();
+              putc_poll (*p++); 
+            }
+          else
+            putc_queue (*p++);
+        }
+      intr_set_level (old_level);
+      return;
     }
-  else 
+
+  for (;;) 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      size_t n = spscq_put (&txq, p, size);
+      p += n;
+      size -= n;
+
+      old_level = intr_disable ();
+      write_ier ();
+      if (size == 0) 
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          intr_set_level (old_level);
+          break;
         }
 
-      intq_putc (&txq, byte); 
-      write_ier ();
+      /* The queue is full.  Wait for serial_interrupt() to make
+         room. */
+      while (spscq_full (&txq)) 
+        {
+          tx_waiter = thread_current ();
+          thread_block ();
+        }
+      intr_set_level (old_level);
     }
-  
-  intr_set_level (old_level);
+  tx_producing = false;
+}
+
+/* Tests and sets TX_PRODUCING in one atomic step, so that two
+   CPUs cannot both become the producer.  Returns true if the
+   caller is now the producer, false if another thread already
+   was. */
+static bool
+claim_producer (void)
+{
+  uint8_t was_producing = true;
+
+  asm volatile ("xchgb %0, %1"
+                : "+q" (was_producing), "+m" (tx_producing) : : "memory");
+  return !was_producing;
 }
 
 /* Flushes anything in the serial buffer out the port in polling
@@ -135,8 +202,10 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  uint8_t byte;
+
+  while (spscq_get (&txq, &byte, 1) > 0)
+    putc_poll (byte);
   intr_set_level (old_level);
 }
 
@@ -182,7 +251,7 @@ write_ier (void)
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
+  if (!spscq_empty (&txq))
     ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
@@ -205,6 +274,37 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* Adds BYTE to the transmit queue, on behalf of a caller that
+   is not the queue's usual producer.  Interrupts must be off. */
+static void
+putc_queue (uint8_t byte) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (tx_producing) 
+    {
+      /* We preempted serial_putbuf() in the middle of adding to
+         the queue, so we may not add to it ourselves. */
+      putc_poll (byte);
+      return;
+    }
+
+  if (spscq_full (&txq)) 
+    {
+      /* Interrupts are off and the transmit queue is full.
+         If we wanted to wait for the queue to empty,
+         we'd have to reenable interrupts.
+         That's impolite, so we'll send a character via
+         polling instead. */
+      uint8_t old;
+      spscq_get (&txq, &old, 1);
+      putc_poll (old); 
+    }
+
+  spscq_put (&txq, &byte, 1);
+  write_ier ();
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
@@ -220,8 +320,19 @@ serial_interrupt (struct intr_frame *f UNUSED)
 
   /* As long as we have a byte to transmit, and the hardware is
      ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  while (!spscq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
+    {
+      uint8_t byte;
+      spscq_get (&txq, &byte, 1);
+      outb (THR_REG, byte);
+    }
+
+  /* Wake up a thread waiting for room in the queue. */
+  if (tx_waiter != NULL && !spscq_full (&txq)) 
+    {
+      thread_unblock (tx_waiter);
+      tx_waiter = NULL;
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
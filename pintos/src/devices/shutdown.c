@@ -5,6 +5,9 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -12,6 +15,10 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
+#include "filesys/journal.h"
+#endif
+#ifdef VM
+#include "vm/swap.h"
 #endif
 
 /* Keyboard control register port. */
@@ -94,6 +101,7 @@ shutdown_power_off (void)
   filesys_done ();
 #endif
 
+  trace_dump ();
   print_stats ();
 
   printf ("Powering off...\n");
@@ -120,8 +128,14 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  palloc_print_stats ();
+  profile_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  journal_print_stats ();
+#endif
+#ifdef VM
+  swap_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
@@ -0,0 +1,101 @@
+#include "devices/spscq.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/synch.h"
+
+/* Mask that reduces a free-running index to a BUF offset. */
+#define SPSCQ_MASK (SPSCQ_BUFSIZE - 1)
+
+/* Initializes queue Q. */
+void
+spscq_init (struct spscq *q)
+{
+  ASSERT ((SPSCQ_BUFSIZE & SPSCQ_MASK) == 0);
+  q->head = q->tail = 0;
+}
+
+/* Returns the number of bytes in Q. */
+size_t
+spscq_used (const struct spscq *q)
+{
+  return q->head - q->tail;
+}
+
+/* Returns the number of bytes that may be added to Q. */
+size_t
+spscq_room (const struct spscq *q)
+{
+  return SPSCQ_BUFSIZE - spscq_used (q);
+}
+
+/* Returns true if Q is empty, false otherwise. */
+bool
+spscq_empty (const struct spscq *q)
+{
+  return q->head == q->tail;
+}
+
+/* Returns true if Q is full, false otherwise. */
+bool
+spscq_full (const struct spscq *q)
+{
+  return spscq_used (q) == SPSCQ_BUFSIZE;
+}
+
+/* Adds up to SIZE bytes from BUFFER to the end of Q, as many as
+   fit, and returns the number of bytes added.
+   Only the producer may call this function. */
+size_t
+spscq_put (struct spscq *q, const void *buffer, size_t size)
+{
+  const uint8_t *src = buffer;
+  uint32_t head = q->head;
+  size_t ofs = head & SPSCQ_MASK;
+  size_t room = spscq_room (q);
+  size_t chunk;
+
+  if (size > room)
+    size = room;
+  barrier ();
+
+  /* Copy in at most two pieces, wrapping around the end of
+     the buffer. */
+  chunk = SPSCQ_BUFSIZE - ofs;
+  if (chunk > size)
+    chunk = size;
+  memcpy (q->buf + ofs, src, chunk);
+  memcpy (q->buf, src + chunk, size - chunk);
+
+  /* Publish the bytes only after they are in place. */
+  barrier ();
+  q->head = head + size;
+  return size;
+}
+
+/* Removes up to SIZE bytes from the front of Q into BUFFER, as
+   many as are available, and returns the number removed.
+   Only the consumer may call this function. */
+size_t
+spscq_get (struct spscq *q, void *buffer, size_t size)
+{
+  uint8_t *dst = buffer;
+  uint32_t tail = q->tail;
+  size_t ofs = tail & SPSCQ_MASK;
+  size_t used = spscq_used (q);
+  size_t chunk;
+
+  if (size > used)
+    size = used;
+  barrier ();
+
+  chunk = SPSCQ_BUFSIZE - ofs;
+  if (chunk > size)
+    chunk = size;
+  memcpy (dst, q->buf + ofs, chunk);
+  memcpy (dst + chunk, q->buf, size - chunk);
+
+  /* Release the space only after the bytes are copied out. */
+  barrier ();
+  q->tail = tail + size;
+  return size;
+}
@@ -0,0 +1,45 @@
+#ifndef DEVICES_SPSCQ_H
+#define DEVICES_SPSCQ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A "single-producer, single-consumer queue", a circular buffer
+   of bytes that one producer and one consumer may access
+   concurrently without a lock and without disabling interrupts.
+
+   Unlike an intq (see devices/intq.h), an spscq never blocks:
+   spscq_put() and spscq_get() transfer as many bytes as fit or
+   are available and return the count.  Any waiting, and any
+   exclusion among multiple producers or multiple consumers, is
+   up to the caller.
+
+   The producer owns HEAD and the consumer owns TAIL.  Each side
+   reads the other's index, copies bytes, and only then publishes
+   its own index, with an optimization barrier in between, so
+   the other side never sees a position whose bytes are not yet
+   in place.  Both indexes run freely and are reduced modulo
+   SPSCQ_BUFSIZE only when indexing BUF, so a full queue is
+   distinguishable from an empty one without wasting a byte. */
+
+/* Queue buffer size, in bytes.  Must be a power of 2. */
+#define SPSCQ_BUFSIZE 1024
+
+/* A lock-free circular queue of bytes. */
+struct spscq
+  {
+    uint8_t buf[SPSCQ_BUFSIZE]; /* Buffer. */
+    volatile uint32_t head;     /* New data is written here. */
+    volatile uint32_t tail;     /* Old data is read here. */
+  };
+
+void spscq_init (struct spscq *);
+size_t spscq_used (const struct spscq *);
+size_t spscq_room (const struct spscq *);
+bool spscq_empty (const struct spscq *);
+bool spscq_full (const struct spscq *);
+size_t spscq_put (struct spscq *, const void *, size_t);
+size_t spscq_get (struct spscq *, void *, size_t);
+
+#endif /* devices/spscq.h */
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
   
@@ -20,22 +21,28 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Alarms that have been set and not gone off, soonest first. */
+static struct list alarm_list;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static list_less_func alarm_less;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
-   and registers the corresponding interrupt. */
+   or faster if the profiler wants more samples, and registers
+   the corresponding interrupt. */
 void
 timer_init (void) 
 {
-  pit_configure_channel (0, 2, TIMER_FREQ);
+  pit_configure_channel (0, 2, TIMER_FREQ * profile_intrs_per_tick ());
+  list_init (&alarm_list);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -66,6 +73,20 @@ timer_calibrate (void)
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
 }
 
+/* Sets loops_per_tick from LOOPS_PER_SECOND, as printed by
+   timer_calibrate() on an earlier boot of the same machine, in
+   place of calibrating. */
+void
+timer_set_calibration (uint64_t loops_per_second)
+{
+  ASSERT (loops_per_second / TIMER_FREQ > 0);
+  ASSERT (loops_per_second / TIMER_FREQ <= UINT32_MAX);
+
+  loops_per_tick = loops_per_second / TIMER_FREQ;
+  printf ("Timer calibration: %'"PRIu64" loops/s, from -loops.\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ);
+}
+
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) 
@@ -96,6 +117,40 @@ timer_sleep (int64_t ticks)
     thread_yield ();
 }
 
+/* Initializes ALARM, which is not set. */
+void
+timer_alarm_init (struct timer_alarm *alarm)
+{
+  alarm->pending = false;
+}
+
+/* Sets ALARM to up SEMA once timer_ticks() reaches DEADLINE, at
+   once if it already has.  If ALARM is already set, this replaces
+   its deadline and semaphore.  May be called from an interrupt
+   handler. */
+void
+timer_alarm_set (struct timer_alarm *alarm, int64_t deadline,
+                 struct semaphore *sema)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (alarm->pending)
+    list_remove (&alarm->elem);
+  alarm->deadline = deadline;
+  alarm->sema = sema;
+  if (deadline <= ticks)
+    {
+      alarm->pending = false;
+      sema_up (sema);
+    }
+  else
+    {
+      alarm->pending = true;
+      list_insert_ordered (&alarm_list, &alarm->elem, alarm_less, NULL);
+    }
+  intr_set_level (old_level);
+}
+
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
    turned on. */
 void
@@ -168,12 +223,35 @@ timer_print_stats (void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
+  if (!profile_timer_interrupt (args))
+    return;
   ticks++;
+  while (!list_empty (&alarm_list))
+    {
+      struct timer_alarm *alarm = list_entry (list_front (&alarm_list),
+                                              struct timer_alarm, elem);
+      if (alarm->deadline > ticks)
+        break;
+      list_pop_front (&alarm_list);
+      alarm->pending = false;
+      sema_up (alarm->sema);
+    }
   thread_tick ();
 }
 
+/* Returns true if alarm A_ goes off before alarm B_. */
+static bool
+alarm_less (const struct list_elem *a_, const struct list_elem *b_,
+            void *aux UNUSED)
+{
+  const struct timer_alarm *a = list_entry (a_, struct timer_alarm, elem);
+  const struct timer_alarm *b = list_entry (b_, struct timer_alarm, elem);
+
+  return a->deadline < b->deadline;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
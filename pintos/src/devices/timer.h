@@ -1,7 +1,9 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -9,6 +11,7 @@
 
 void timer_init (void);
 void timer_calibrate (void);
+void timer_set_calibration (uint64_t loops_per_second);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
@@ -19,6 +22,20 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+/* A one-shot alarm: at its deadline, the timer interrupt ups a
+   semaphore, which lets a thread sleep without polling. */
+struct timer_alarm
+  {
+    struct list_elem elem;              /* Element in alarm list. */
+    int64_t deadline;                   /* Tick at which to go off. */
+    struct semaphore *sema;             /* Semaphore to up. */
+    bool pending;                       /* Set and not yet gone off? */
+  };
+
+void timer_alarm_init (struct timer_alarm *);
+void timer_alarm_set (struct timer_alarm *, int64_t deadline,
+                      struct semaphore *);
+
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
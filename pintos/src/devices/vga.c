@@ -50,6 +50,16 @@ init (void)
    characters in the conventional ways.  */
 void
 vga_putc (int c)
+{
+  char ch = c;
+  vga_putbuf (&ch, 1);
+}
+
+/* Writes the SIZE characters in BUFFER to the VGA text display,
+   interpreting control characters in the conventional ways.
+   The hardware cursor is moved only once, at the end. */
+void
+vga_putbuf (const char *buffer, size_t size)
 {
   /* Disable interrupts to lock out interrupt handlers
      that might write to the console. */
@@ -57,43 +67,47 @@ vga_putc (int c)
 
   init ();
   
-  switch (c) 
+  while (size-- > 0)
     {
-    case '\n':
-      newline ();
-      break;
-
-    case '\f':
-      cls ();
-      break;
-
-    case '\b':
-      if (cx > 0)
-        cx--;
-      break;
-      
-    case '\r':
-      cx = 0;
-      break;
-
-    case '\t':
-      cx = ROUND_UP (cx + 1, 8);
-      if (cx >= COL_CNT)
-        newline ();
-      break;
-
-    case '\a':
-      intr_set_level (old_level);
-      speaker_beep ();
-      intr_disable ();
-      break;
-      
-    default:
-      fb[cy][cx][0] = c;
-      fb[cy][cx][1] = GRAY_ON_BLACK;
-      if (++cx >= COL_CNT)
-        newline ();
-      break;
+      uint8_t c = *buffer++;
+      switch (c) 
+        {
+        case '\n':
+          newline ();
+          break;
+
+        case '\f':
+          cls ();
+          break;
+
+        case '\b':
+          if (cx > 0)
+            cx--;
+          break;
+          
+        case '\r':
+          cx = 0;
+          break;
+
+        case '\t':
+          cx = ROUND_UP (cx + 1, 8);
+          if (cx >= COL_CNT)
+            newline ();
+          break;
+
+        case '\a':
+          intr_set_level (old_level);
+          speaker_beep ();
+          intr_disable ();
+          break;
+          
+        default:
+          fb[cy][cx][0] = c;
+          fb[cy][cx][1] = GRAY_ON_BLACK;
+          if (++cx >= COL_CNT)
+            newline ();
+          break;
+        }
     }
 
   /* Update cursor position. */
@@ -0,0 +1,149 @@
+/* aiocat.c
+
+   Reads a file from start to finish and prints a checksum of its
+   contents, as a benchmark of asynchronous I/O.
+
+   Usage: aiocat [-b] FILE
+   By default, keeps DEPTH reads of CHUNK bytes in flight at once
+   through an I/O ring (see lib/aio.h), summing each chunk while
+   the kernel reads the ones after it.  With -b, reads the file
+   one chunk at a time with read() instead, for comparison.  Both
+   ways should print the same checksum; run each under the
+   simulator and compare the tick counts printed at power off. */
+
+#include <aio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Reads in flight, and bytes per read. */
+#define DEPTH 8
+#define CHUNK 4096
+
+static struct io_ring ring __attribute__ ((aligned (2048)));
+static char buffers[DEPTH][CHUNK];
+
+/* Returns the sum of the N bytes in BUF. */
+static unsigned
+sum_bytes (const char *buf, int n)
+{
+  unsigned sum = 0;
+  int i;
+
+  for (i = 0; i < n; i++)
+    sum += (unsigned char) buf[i];
+  return sum;
+}
+
+/* Reads FD with read(), adding the sum of its bytes to *SUM and
+   their number to *TOTAL.  Returns true if successful. */
+static bool
+read_blocking (int fd, unsigned *sum, int *total)
+{
+  for (;;)
+    {
+      int n = read (fd, buffers[0], CHUNK);
+      if (n <= 0)
+        return n == 0;
+      *sum += sum_bytes (buffers[0], n);
+      *total += n;
+    }
+}
+
+/* Reads FD through the I/O ring, adding the sum of its bytes to
+   *SUM and their number to *TOTAL.  Returns true if
+   successful. */
+static bool
+read_async (int fd, unsigned *sum, int *total)
+{
+  int free_slots[DEPTH];
+  int free_cnt = DEPTH;
+  int size = filesize (fd);
+  int next = 0;
+  int inflight = 0;
+  int i;
+
+  if (io_setup (&ring) < 0)
+    return false;
+  for (i = 0; i < DEPTH; i++)
+    free_slots[i] = i;
+
+  while (next < size || inflight > 0)
+    {
+      /* Queue a read into each free buffer. */
+      while (free_cnt > 0 && next < size)
+        {
+          struct io_sqe *sqe = &ring.sqes[ring.sq_tail % IO_RING_ENTRIES];
+          int slot = free_slots[--free_cnt];
+
+          sqe->op = IO_READ;
+          sqe->fd = fd;
+          sqe->buf = buffers[slot];
+          sqe->size = CHUNK;
+          sqe->offset = next;
+          sqe->user_data = slot;
+          asm volatile ("" : : : "memory");
+          ring.sq_tail++;
+          next += CHUNK;
+          inflight++;
+        }
+      io_submit (IO_RING_ENTRIES);
+
+      /* Sum whatever has arrived, in whatever order. */
+      io_wait (1);
+      while (ring.cq_head != ring.cq_tail)
+        {
+          struct io_cqe *cqe = &ring.cqes[ring.cq_head % IO_RING_ENTRIES];
+
+          if (cqe->result < 0)
+            return false;
+          *sum += sum_bytes (buffers[cqe->user_data], cqe->result);
+          *total += cqe->result;
+          free_slots[free_cnt++] = cqe->user_data;
+          inflight--;
+          ring.cq_head++;
+        }
+    }
+  return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+  bool blocking = false;
+  unsigned sum = 0;
+  int total = 0;
+  bool ok;
+  int fd;
+
+  if (argc > 1 && !strcmp (argv[1], "-b"))
+    {
+      blocking = true;
+      argc--;
+      argv++;
+    }
+  if (argc != 2)
+    {
+      printf ("usage: aiocat [-b] FILE\n");
+      return EXIT_FAILURE;
+    }
+
+  fd = open (argv[1]);
+  if (fd < 0)
+    {
+      printf ("aiocat: %s: open failed\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  ok = (blocking
+        ? read_blocking (fd, &sum, &total)
+        : read_async (fd, &sum, &total));
+  if (!ok)
+    {
+      printf ("aiocat: %s: read failed\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  printf ("aiocat: %d bytes, checksum %u\n", total, sum);
+  close (fd);
+  return EXIT_SUCCESS;
+}
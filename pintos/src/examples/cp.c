@@ -37,7 +37,25 @@ main (int argc, char *argv[])
       return EXIT_FAILURE;
     }
 
-  /* Copy data. */
+  /* Copy data inside the kernel, if it can, without a trip
+     through our buffer. */
+  for (;;)
+    {
+      int bytes_copied = copy_file_range (in_fd, out_fd, 64 * 1024);
+      if (bytes_copied < 0)
+        break;
+      if (bytes_copied == 0)
+        {
+          if (tell (in_fd) < (unsigned) filesize (in_fd))
+            {
+              printf ("%s: write failed\n", argv[2]);
+              return EXIT_FAILURE;
+            }
+          return EXIT_SUCCESS;
+        }
+    }
+
+  /* Otherwise, copy through a buffer. */
   for (;;) 
     {
       char buffer[1024];
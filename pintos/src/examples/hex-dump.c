@@ -10,6 +10,9 @@ main (int argc, char *argv[])
 {
   bool success = true;
   int i;
+
+  /* Print a screenful of lines per system call, not one. */
+  stdout_set_buffered (true);
   
   for (i = 1; i < argc; i++) 
     {
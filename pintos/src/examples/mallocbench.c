@@ -0,0 +1,116 @@
+/* mallocbench.c
+
+   Exercises the user-space malloc() in lib/user/malloc.c.
+
+   Usage: mallocbench [PAIRS]
+   First performs PAIRS (default 1000000) small malloc()/free()
+   pairs of 1 to 256 bytes each, replacing blocks in a working
+   set of WORKING_SET live blocks.  Then allocates, fills, checks,
+   and frees large blocks of random sizes, which makes the
+   allocator split and merge blocks and grow and shrink the heap.
+   Time the run with the "Timer" line that Pintos prints at
+   power off. */
+
+#include <malloc.h>
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Number of small blocks kept live at once. */
+#define WORKING_SET 256
+
+/* Number of large blocks kept live at once, and number of large
+   blocks to allocate in all. */
+#define LARGE_SET 16
+#define LARGE_CNT 2000
+
+static unsigned char *small[WORKING_SET];
+static size_t small_size[WORKING_SET];
+
+static unsigned char *large[LARGE_SET];
+static size_t large_size[LARGE_SET];
+
+/* Returns a byte value to fill block P, of SIZE bytes, with. */
+static unsigned char
+fill_byte (const void *p, size_t size)
+{
+  return ((unsigned) p >> 4) ^ size;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int pairs = argc > 1 ? atoi (argv[1]) : 1000000;
+  void *start = sbrk (0);
+  int i;
+
+  random_init (0);
+
+  /* Small blocks. */
+  for (i = 0; i < pairs; i++)
+    {
+      int slot = random_ulong () % WORKING_SET;
+
+      if (small[slot] != NULL)
+        {
+          if (small[slot][0] != fill_byte (small[slot], small_size[slot]))
+            {
+              printf ("mallocbench: small block %p corrupted\n", small[slot]);
+              return EXIT_FAILURE;
+            }
+          free (small[slot]);
+        }
+      small_size[slot] = random_ulong () % 256 + 1;
+      small[slot] = malloc (small_size[slot]);
+      if (small[slot] == NULL)
+        {
+          printf ("mallocbench: out of memory after %d pairs\n", i);
+          return EXIT_FAILURE;
+        }
+      small[slot][0] = fill_byte (small[slot], small_size[slot]);
+    }
+  for (i = 0; i < WORKING_SET; i++)
+    free (small[i]);
+  printf ("mallocbench: %d small pairs, heap grew by %d bytes\n",
+          pairs, (int) ((char *) sbrk (0) - (char *) start));
+
+  /* Large blocks. */
+  for (i = 0; i < LARGE_CNT; i++)
+    {
+      int slot = random_ulong () % LARGE_SET;
+
+      if (large[slot] != NULL)
+        {
+          unsigned char c = fill_byte (large[slot], large_size[slot]);
+          size_t j;
+
+          for (j = 0; j < large_size[slot]; j += 512)
+            if (large[slot][j] != c)
+              {
+                printf ("mallocbench: large block %p corrupted\n",
+                        large[slot]);
+                return EXIT_FAILURE;
+              }
+          free (large[slot]);
+        }
+      large_size[slot] = random_ulong () % (64 * 1024) + 1025;
+      large[slot] = malloc (large_size[slot]);
+      if (large[slot] == NULL)
+        {
+          printf ("mallocbench: out of memory after %d large blocks\n", i);
+          return EXIT_FAILURE;
+        }
+      memset (large[slot], fill_byte (large[slot], large_size[slot]),
+              large_size[slot]);
+    }
+  printf ("mallocbench: %d large blocks, heap holds %d bytes\n",
+          LARGE_CNT, (int) ((char *) sbrk (0) - (char *) start));
+  for (i = 0; i < LARGE_SET; i++)
+    free (large[i]);
+  printf ("mallocbench: after freeing, heap holds %d bytes\n",
+          (int) ((char *) sbrk (0) - (char *) start));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/* mtmatmult.c
+
+   Multithreaded version of matmult.c.
+
+   Usage: mtmatmult [THREADS]
+   Splits the rows of the product among THREADS (default 4)
+   threads started with thread_create(), joins them, and checks
+   the result.  On a multiprocessor the threads run in parallel:
+   compare the "Timer" line that Pintos prints at power off for
+   "mtmatmult 1" and "mtmatmult 4" under --smp=4. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+#define DIM 128
+
+/* Most threads we will start. */
+#define MAX_THREADS 16
+
+int A[DIM][DIM];
+int B[DIM][DIM];
+int C[DIM][DIM];
+
+/* Rows computed by one thread. */
+struct rows
+  {
+    int start, end;
+  };
+
+/* Computes the rows of C given by ROWS_. */
+static int
+multiply (void *rows_)
+{
+  struct rows *rows = rows_;
+  int i, j, k;
+
+  for (i = rows->start; i < rows->end; i++)
+    for (j = 0; j < DIM; j++)
+      {
+        int sum = 0;
+
+        for (k = 0; k < DIM; k++)
+          sum += A[i][k] * B[k][j];
+        C[i][j] = sum;
+      }
+  return rows->end - rows->start;
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct rows rows[MAX_THREADS];
+  tid_t tids[MAX_THREADS];
+  int thread_cnt = argc > 1 ? atoi (argv[1]) : 4;
+  int i, j;
+
+  if (thread_cnt < 1 || thread_cnt > MAX_THREADS)
+    {
+      printf ("mtmatmult: thread count must be between 1 and %d\n",
+              MAX_THREADS);
+      return EXIT_FAILURE;
+    }
+
+  /* Initialize the matrices. */
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      {
+        A[i][j] = i;
+        B[i][j] = j;
+      }
+
+  /* Multiply matrices, a band of rows per thread. */
+  for (i = 0; i < thread_cnt; i++)
+    {
+      rows[i].start = DIM * i / thread_cnt;
+      rows[i].end = DIM * (i + 1) / thread_cnt;
+      tids[i] = thread_create (multiply, &rows[i]);
+      if (tids[i] == TID_ERROR)
+        {
+          printf ("mtmatmult: thread_create failed\n");
+          return EXIT_FAILURE;
+        }
+    }
+  for (i = 0; i < thread_cnt; i++)
+    if (thread_join (tids[i]) != rows[i].end - rows[i].start)
+      {
+        printf ("mtmatmult: thread %d returned a bad status\n", i);
+        return EXIT_FAILURE;
+      }
+
+  /* Check the product: C[i][j] is the sum of i * j, DIM times. */
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      if (C[i][j] != DIM * i * j)
+        {
+          printf ("mtmatmult: C[%d][%d] is wrong\n", i, j);
+          return EXIT_FAILURE;
+        }
+
+  printf ("mtmatmult: %d threads, C[%d][%d] = %d\n",
+          thread_cnt, DIM - 1, DIM - 1, C[DIM - 1][DIM - 1]);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/* pipebench.c
+
+   Streams data from a parent process to a child process through
+   an anonymous pipe, as a producer/consumer benchmark.
+
+   Usage: pipebench [KB]
+   The parent creates a pipe, starts itself as the child with the
+   pipe's file descriptors on the command line, writes KB
+   kilobytes (default 1024) into the pipe, and closes it.  The
+   child reads until end of file and exits with a checksum of
+   the data, which the parent verifies. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+static char buffer[4096];
+
+/* Reads from RFD until end of file and returns the sum of the
+   bytes read. */
+static int
+consume (int rfd, int wfd)
+{
+  int sum = 0;
+  int total = 0;
+
+  /* Otherwise our own write end keeps the pipe from reaching
+     end of file. */
+  close (wfd);
+
+  for (;;)
+    {
+      int i;
+      int n = read (rfd, buffer, sizeof buffer);
+      if (n <= 0)
+        break;
+      for (i = 0; i < n; i++)
+        sum += (unsigned char) buffer[i];
+      total += n;
+    }
+  printf ("pipebench: child read %d bytes\n", total);
+  return sum;
+}
+
+int
+main (int argc, char *argv[])
+{
+  char cmd[64];
+  int fds[2];
+  int kb = 1024;
+  int sum = 0;
+  int i;
+  pid_t child;
+
+  if (argc == 4 && !strcmp (argv[1], "-c"))
+    return consume (atoi (argv[2]), atoi (argv[3]));
+  if (argc == 2)
+    kb = atoi (argv[1]);
+
+  if (pipe (fds) < 0)
+    {
+      printf ("pipebench: pipe failed\n");
+      return EXIT_FAILURE;
+    }
+
+  snprintf (cmd, sizeof cmd, "pipebench -c %d %d", fds[0], fds[1]);
+  child = exec (cmd);
+  if (child == PID_ERROR)
+    {
+      printf ("pipebench: exec failed\n");
+      return EXIT_FAILURE;
+    }
+  close (fds[0]);
+
+  for (i = 0; i < (int) sizeof buffer; i++)
+    buffer[i] = i * 7;
+  for (i = 0; i < kb / 4; i++)
+    {
+      int j;
+      if (write (fds[1], buffer, sizeof buffer) != sizeof buffer)
+        {
+          printf ("pipebench: write failed\n");
+          return EXIT_FAILURE;
+        }
+      for (j = 0; j < (int) sizeof buffer; j++)
+        sum += (unsigned char) buffer[j];
+    }
+  close (fds[1]);
+
+  if (wait (child) != sum)
+    {
+      printf ("pipebench: checksum mismatch\n");
+      return EXIT_FAILURE;
+    }
+  printf ("pipebench: %d kB transferred\n", kb / 4 * 4);
+  return EXIT_SUCCESS;
+}
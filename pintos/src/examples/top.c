@@ -0,0 +1,81 @@
+/* top.c
+
+   Prints the threads that have spent the most time running,
+   with their accounting from getstats().
+
+   Usage: top [N]
+   Lists the N busiest threads (default 10), busiest first: how
+   many timer ticks each has run, how many times it blocked
+   (VOL) or was preempted (INVOL), its page faults, the system
+   calls it made, and the bytes it read and wrote through them. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include <threadstat.h>
+
+/* Most threads that we will look at. */
+#define MAX_THREADS 64
+
+static struct thread_stat stats[MAX_THREADS];
+
+/* Returns the total number of system calls ST made. */
+static unsigned
+syscall_total (const struct thread_stat *st)
+{
+  unsigned total = 0;
+  int i;
+
+  for (i = 0; i < SYS_CNT; i++)
+    total += st->syscalls[i];
+  return total;
+}
+
+/* Sorts the CNT entries in STATS by decreasing ticks. */
+static void
+sort_stats (int cnt)
+{
+  int i, j;
+
+  for (i = 1; i < cnt; i++)
+    {
+      struct thread_stat st = stats[i];
+
+      for (j = i; j > 0 && stats[j - 1].ticks < st.ticks; j--)
+        stats[j] = stats[j - 1];
+      stats[j] = st;
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  int n = argc > 1 ? atoi (argv[1]) : 10;
+  int cnt = 0;
+  tid_t tid = 0;
+  int i;
+
+  /* Take a snapshot of every thread. */
+  while (cnt < MAX_THREADS
+         && (tid = getstats (tid, &stats[cnt])) != TID_ERROR)
+    {
+      cnt++;
+      tid++;
+    }
+  sort_stats (cnt);
+
+  printf ("%5s %-15s %c %8s %6s %6s %6s %8s %10s %10s\n",
+          "TID", "NAME", 'S', "TICKS", "VOL", "INVOL", "FAULTS",
+          "SYSCALLS", "READ", "WRITTEN");
+  for (i = 0; i < cnt && i < n; i++)
+    {
+      const struct thread_stat *st = &stats[i];
+
+      printf ("%5d %-15s %c %8lld %6u %6u %6u %8u %10llu %10llu\n",
+              st->tid, st->name, st->state, st->ticks,
+              st->voluntary_switches, st->involuntary_switches,
+              st->page_faults, syscall_total (st),
+              st->read_bytes, st->write_bytes);
+    }
+  return EXIT_SUCCESS;
+}
@@ -1,8 +1,15 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include <round.h>
 #include "filesys/inode.h"
+#include "filesys/pipe.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Most pages in the buffer that file_copy() moves data through. */
+#define COPY_PAGES 16
 
 /* An open file. */
 struct file 
@@ -11,6 +18,8 @@ struct file
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
     struct lock lock;          /* Lock */
+    struct pipe *pipe;          /* Pipe, if this is a pipe end. */
+    bool pipe_writer;           /* Write end (true) or read end? */
   };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -36,11 +45,31 @@ file_open (struct inode *inode)
     }
 }
 
-/* Opens and returns a new file for the same inode as FILE.
+/* Opens and returns a new file that is the write end of PIPE if
+   WRITER is true, or its read end otherwise.  Returns a null
+   pointer if an allocation fails. */
+struct file *
+file_open_pipe (struct pipe *pipe, bool writer) 
+{
+  struct file *file = calloc (1, sizeof *file);
+  if (file != NULL)
+    {
+      file->pipe = pipe;
+      file->pipe_writer = writer;
+      lock_init (&file->lock);
+      pipe_open_end (pipe, writer);
+    }
+  return file;
+}
+
+/* Opens and returns a new file for the same inode as FILE,
+   or for the same end of the same pipe.
    Returns a null pointer if unsuccessful. */
 struct file *
 file_reopen (struct file *file) 
 {
+  if (file->pipe != NULL)
+    return file_open_pipe (file->pipe, file->pipe_writer);
   return file_open (inode_reopen (file->inode));
 }
 
@@ -50,12 +79,21 @@ file_close (struct file *file)
 {
   if (file != NULL)
     {
+      if (file->pipe != NULL)
+        pipe_close_end (file->pipe, file->pipe_writer);
       file_allow_write (file);
       inode_close (file->inode);
       free (file); 
     }
 }
 
+/* Returns true if FILE is an end of a pipe. */
+bool
+file_is_pipe (struct file *file) 
+{
+  return file->pipe != NULL;
+}
+
 /* Returns the inode encapsulated by FILE. */
 struct inode *
 file_get_inode (struct file *file) 
@@ -67,11 +105,18 @@ file_get_inode (struct file *file)
    starting at the file's current position.
    Returns the number of bytes actually read,
    which may be less than SIZE if end of file is reached.
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   If FILE is the read end of a pipe, waits for data instead;
+   see pipe_read(). */
 off_t
 file_read (struct file *file, void *buffer, off_t size) 
 {
-  off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  off_t bytes_read;
+
+  if (file->pipe != NULL)
+    return file->pipe_writer ? -1 : pipe_read (file->pipe, buffer, size);
+
+  bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_read;
   return bytes_read;
 }
@@ -93,11 +138,18 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
    which may be less than SIZE if end of file is reached.
    (Normally we'd grow the file in that case, but file growth is
    not yet implemented.)
-   Advances FILE's position by the number of bytes read. */
+   Advances FILE's position by the number of bytes read.
+   If FILE is the write end of a pipe, waits for room instead;
+   see pipe_write(). */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
 {
-  off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+  off_t bytes_written;
+
+  if (file->pipe != NULL)
+    return file->pipe_writer ? pipe_write (file->pipe, buffer, size) : -1;
+
+  bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
   file->pos += bytes_written;
   return bytes_written;
 }
@@ -116,6 +168,69 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from SRC, starting at its current
+   position, to DST, at its current position, and advances both
+   positions by the number of bytes copied.  The data passes
+   through a buffer of kernel memory, so the caller needs no
+   buffer of its own.  Either file may be a pipe end.  Returns
+   the number of bytes copied, which is less than SIZE if SRC
+   reaches end of file, if a read from a pipe comes up short, or
+   if DST can't take any more; returns -1 if nothing was copied
+   because of an error.
+
+   A file's data sectors are contiguous, and inode_read_at() and
+   inode_write_at() move the whole sectors of a request with one
+   block_read_multiple() or block_write_multiple() call.  So the
+   copy moves data in runs as long as the buffer, which is up to
+   COPY_PAGES pages, falling back to fewer if memory is short. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size)
+{
+  size_t page_cnt = COPY_PAGES;
+  off_t buf_size;
+  uint8_t *buffer;
+  off_t copied = 0;
+  bool error = false;
+
+  if ((size_t) size < COPY_PAGES * PGSIZE)
+    page_cnt = size > 0 ? DIV_ROUND_UP (size, PGSIZE) : 1;
+  while ((buffer = palloc_get_multiple (0, page_cnt)) == NULL)
+    if (page_cnt == 1)
+      return -1;
+    else
+      page_cnt /= 2;
+  buf_size = page_cnt * PGSIZE;
+
+  while (copied < size)
+    {
+      off_t chunk = size - copied < buf_size ? size - copied : buf_size;
+      off_t bytes_read, bytes_written;
+
+      bytes_read = file_read (src, buffer, chunk);
+      if (bytes_read <= 0)
+        {
+          error = bytes_read < 0;
+          break;
+        }
+      bytes_written = file_write (dst, buffer, bytes_read);
+      if (bytes_written > 0)
+        copied += bytes_written;
+      if (bytes_written != bytes_read)
+        {
+          /* Leave SRC just past what was copied, if we can. */
+          if (src->pipe == NULL)
+            src->pos -= bytes_read - (bytes_written > 0 ? bytes_written : 0);
+          error = bytes_written < 0;
+          break;
+        }
+      if (bytes_read < chunk)
+        break;
+    }
+  palloc_free_multiple (buffer, page_cnt);
+
+  return copied == 0 && error ? -1 : copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -143,11 +258,13 @@ file_allow_write (struct file *file)
     }
 }
 
-/* Returns the size of FILE in bytes. */
+/* Returns the size of FILE in bytes, or 0 for a pipe. */
 off_t
 file_length (struct file *file) 
 {
   ASSERT (file != NULL);
+  if (file->pipe != NULL)
+    return 0;
   return inode_length (file->inode);
 }
 
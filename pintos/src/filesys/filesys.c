@@ -6,6 +6,7 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/journal.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
@@ -23,6 +24,7 @@ filesys_init (bool format)
 
   inode_init ();
   free_map_init ();
+  journal_init (format);
 
   if (format) 
     do_format ();
@@ -35,25 +37,39 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  journal_done ();
   free_map_close ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
    Returns true if successful, false otherwise.
    Fails if a file named NAME already exists,
+   if the disk is full,
    or if internal memory allocation fails. */
 bool
 filesys_create (const char *name, off_t initial_size) 
 {
-  block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
-  if (!success && inode_sector != 0) 
-    free_map_release (inode_sector, 1);
-  dir_close (dir);
+  block_sector_t inode_sector;
+  struct dir *dir;
+  bool success;
+
+  /* Retry once the sectors of files just deleted are free, if
+     that could help. */
+  do
+    {
+      inode_sector = 0;
+      journal_begin ();
+      dir = dir_open_root ();
+      success = (dir != NULL
+                 && free_map_allocate (1, &inode_sector)
+                 && inode_create (inode_sector, initial_size)
+                 && dir_add (dir, name, inode_sector));
+      if (!success && inode_sector != 0) 
+        free_map_release (inode_sector, 1);
+      dir_close (dir);
+      journal_end ();
+    }
+  while (!success && free_map_reclaim ());
 
   return success;
 }
@@ -83,21 +99,37 @@ filesys_open (const char *name)
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  struct dir *dir;
+  bool success;
+
+  journal_begin ();
+  dir = dir_open_root ();
+  success = dir != NULL && dir_remove (dir, name);
   dir_close (dir); 
+  journal_end ();
 
   return success;
 }
+
+/* Writes every completed change to the file system's metadata
+   to disk.  File data is always written through. */
+void
+filesys_sync (void) 
+{
+  journal_commit ();
+}
 
 /* Formats the file system. */
 static void
 do_format (void)
 {
   printf ("Formatting file system...");
+  journal_begin ();
   free_map_create ();
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
+  journal_end ();
+  journal_commit ();
   free_map_close ();
   printf ("done.\n");
 }
@@ -8,6 +8,9 @@
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
 
+/* First of the JOURNAL_SECTORS sectors of the metadata journal. */
+#define JOURNAL_SECTOR 2
+
 /* Block device that contains the file system. */
 struct block *fs_device;
 
@@ -16,5 +19,6 @@ void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
+void filesys_sync (void);
 
 #endif /* filesys/filesys.h */
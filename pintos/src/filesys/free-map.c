@@ -4,30 +4,52 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct bitmap *released;      /* Released, not yet committed. */
+static bool reclaimable;             /* An allocation failed that
+                                        released sectors might
+                                        satisfy once committed? */
+
+static struct file *open_free_map_file (void);
 
 /* Initializes the free map. */
 void
 free_map_init (void) 
 {
   free_map = bitmap_create (block_size (fs_device));
-  if (free_map == NULL)
+  released = bitmap_create (block_size (fs_device));
+  if (free_map == NULL || released == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
+  if (bitmap_file_size (free_map)
+      > JOURNAL_FREE_MAP_SECTORS * BLOCK_SECTOR_SIZE)
+    PANIC ("file system device is too large for the journal");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
    sectors were available or if the free_map file could not be
-   written. */
+   written.
+
+   Sectors released by the running journal transaction are not
+   available until it commits, so this can fail even though a
+   file was just deleted to make room.  Such a failure can't be
+   fixed here, in the middle of an operation, so the caller
+   should end its operation and retry if free_map_reclaim()
+   returns true. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
   block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  if (sector == BITMAP_ERROR
+      && bitmap_any (released, 0, bitmap_size (released)))
+    reclaimable = true;
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
       && !bitmap_write (free_map, free_map_file))
@@ -40,22 +62,63 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT sectors starting at SECTOR available for use, once
+   the running journal transaction commits.  Until then, the
+   metadata that still refers to them on disk is current, so
+   they must not be reused. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  ASSERT (bitmap_none (released, sector, cnt));
+  bitmap_set_multiple (released, sector, cnt, true);
+}
+
+/* Frees the sectors released since the last call and writes the
+   free map, as part of the journal transaction being
+   committed. */
+void
+free_map_commit (void)
+{
+  size_t sector = 0;
+  bool changed = false;
+
+  while ((sector = bitmap_scan (released, sector, 1, true)) != BITMAP_ERROR)
+    {
+      size_t cnt = 1;
+      while (sector + cnt < bitmap_size (released)
+             && bitmap_test (released, sector + cnt))
+        cnt++;
+      bitmap_set_multiple (released, sector, cnt, false);
+      bitmap_set_multiple (free_map, sector, cnt, false);
+      journal_forget (sector, cnt);
+      sector += cnt;
+      changed = true;
+    }
+  if (changed && free_map_file != NULL)
+    bitmap_write (free_map, free_map_file);
+}
+
+/* If free_map_allocate() has failed while sectors were waiting
+   for the running journal transaction to commit, commits it, so
+   that they are free, and returns true.  Otherwise returns false,
+   since retrying the allocation would fail again.  Must not be
+   called between journal_begin() and journal_end(). */
+bool
+free_map_reclaim (void)
+{
+  if (!reclaimable)
+    return false;
+  reclaimable = false;
+  journal_commit ();
+  return true;
 }
 
 /* Opens the free map file and reads it from disk. */
 void
 free_map_open (void) 
 {
-  free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
-  if (free_map_file == NULL)
-    PANIC ("can't open free map");
+  free_map_file = open_free_map_file ();
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
 }
@@ -77,9 +140,23 @@ free_map_create (void)
     PANIC ("free map creation failed");
 
   /* Write bitmap to file. */
-  free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
-  if (free_map_file == NULL)
-    PANIC ("can't open free map");
+  free_map_file = open_free_map_file ();
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
 }
+
+/* Opens the free map file, whose contents are written through
+   the journal. */
+static struct file *
+open_free_map_file (void)
+{
+  struct inode *inode = inode_open (FREE_MAP_SECTOR);
+  struct file *file;
+
+  if (inode != NULL)
+    inode_set_metadata (inode);
+  file = file_open (inode);
+  if (file == NULL)
+    PANIC ("can't open free map");
+  return file;
+}
@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,12 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Pages in the buffer that `extract' and `append' use to copy
+   file data to and from the scratch device, and the number of
+   sectors that it holds. */
+#define COPY_PAGES 16
+#define COPY_SECTORS (COPY_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) 
@@ -79,7 +86,7 @@ fsutil_extract (char **argv UNUSED)
 
   /* Allocate buffers. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  data = palloc_get_multiple (0, COPY_PAGES);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -117,20 +124,27 @@ fsutil_extract (char **argv UNUSED)
 
           printf ("Putting '%s' into the file system...\n", file_name);
 
-          /* Create destination file. */
+          /* Create destination file, which allocates all of its
+             sectors, in one extent, up front. */
           if (!filesys_create (file_name, size))
             PANIC ("%s: create failed", file_name);
           dst = filesys_open (file_name);
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
 
-          /* Do copy. */
+          /* Do copy, as many sectors at a time as DATA holds. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
-                                : size);
-              block_read (src, sector++, data);
+              size_t sectors = DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+              int chunk_size;
+
+              if (sectors > COPY_SECTORS)
+                sectors = COPY_SECTORS;
+              chunk_size = (size > (int) (sectors * BLOCK_SECTOR_SIZE)
+                            ? (int) (sectors * BLOCK_SECTOR_SIZE)
+                            : size);
+              block_read_multiple (src, sector, sectors, data);
+              sector += sectors;
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -151,7 +165,7 @@ fsutil_extract (char **argv UNUSED)
   block_write (src, 0, header);
   block_write (src, 1, header);
 
-  free (data);
+  palloc_free_multiple (data, COPY_PAGES);
   free (header);
 }
 
@@ -177,7 +191,7 @@ fsutil_append (char **argv)
   printf ("Appending '%s' to ustar archive on scratch device...\n", file_name);
 
   /* Allocate buffer. */
-  buffer = malloc (BLOCK_SECTOR_SIZE);
+  buffer = palloc_get_multiple (0, COPY_PAGES);
   if (buffer == NULL)
     PANIC ("couldn't allocate buffer");
 
@@ -197,27 +211,39 @@ fsutil_append (char **argv)
     PANIC ("%s: name too long for ustar format", file_name);
   block_write (dst, sector++, buffer);
 
-  /* Do copy. */
+  /* Do copy, as many sectors at a time as BUFFER holds. */
   while (size > 0) 
     {
-      int chunk_size = size > BLOCK_SECTOR_SIZE ? BLOCK_SECTOR_SIZE : size;
-      if (sector >= block_size (dst))
+      size_t sectors = DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+      off_t chunk_size;
+
+      if (sectors > COPY_SECTORS)
+        sectors = COPY_SECTORS;
+      chunk_size = (size > (off_t) (sectors * BLOCK_SECTOR_SIZE)
+                    ? (off_t) (sectors * BLOCK_SECTOR_SIZE)
+                    : size);
+      if (sector + sectors > block_size (dst))
         PANIC ("%s: out of space on scratch device", file_name);
       if (file_read (src, buffer, chunk_size) != chunk_size)
         PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
-      memset (buffer + chunk_size, 0, BLOCK_SECTOR_SIZE - chunk_size);
-      block_write (dst, sector++, buffer);
+      memset (buffer + chunk_size, 0,
+              sectors * BLOCK_SECTOR_SIZE - chunk_size);
+      block_write_multiple (dst, sector, sectors, buffer);
+      sector += sectors;
       size -= chunk_size;
     }
 
   /* Write ustar end-of-archive marker, which is two consecutive
-     sectors full of zeros.  Don't advance our position past
-     them, though, in case we have more files to append. */
-  memset (buffer, 0, BLOCK_SECTOR_SIZE);
-  block_write (dst, sector, buffer);
-  block_write (dst, sector, buffer + 1);
+     sectors full of zeros, or as much of it as fits.  Don't
+     advance our position past them, though, in case we have more
+     files to append. */
+  memset (buffer, 0, 2 * BLOCK_SECTOR_SIZE);
+  block_write_multiple (dst, sector,
+                        (block_size (dst) - sector < 2
+                         ? block_size (dst) - sector : 2),
+                        buffer);
 
   /* Finish up. */
   file_close (src);
-  free (buffer);
+  palloc_free_multiple (buffer, COPY_PAGES);
 }
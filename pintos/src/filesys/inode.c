@@ -5,11 +5,16 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Number of sectors of zeros that inode_create() writes at once
+   to clear a new file's data. */
+#define ZERO_SECTORS 16
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
@@ -36,6 +41,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    bool metadata;                      /* Data goes through journal? */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -89,14 +95,17 @@ inode_create (block_sector_t sector, off_t length)
       disk_inode->magic = INODE_MAGIC;
       if (free_map_allocate (sectors, &disk_inode->start)) 
         {
-          block_write (fs_device, sector, disk_inode);
+          journal_write (sector, disk_inode);
           if (sectors > 0) 
             {
-              static char zeros[BLOCK_SECTOR_SIZE];
+              static char zeros[ZERO_SECTORS * BLOCK_SECTOR_SIZE];
               size_t i;
               
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
+              for (i = 0; i < sectors; i += ZERO_SECTORS) 
+                block_write_multiple (fs_device, disk_inode->start + i,
+                                      (sectors - i < ZERO_SECTORS
+                                       ? sectors - i : ZERO_SECTORS),
+                                      zeros);
             }
           success = true; 
         } 
@@ -137,10 +146,55 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  inode->metadata = false;
+  journal_read (inode->sector, &inode->data);
   return inode;
 }
 
+/* Marks INODE as holding file system metadata, such as a
+   directory or the free map, so that its data is read and
+   written through the journal like the inode itself. */
+void
+inode_set_metadata (struct inode *inode)
+{
+  inode->metadata = true;
+}
+
+/* Reads the CNT sectors of INODE's data starting at SECTOR into
+   BUFFER. */
+static void
+read_sectors (struct inode *inode, block_sector_t sector, size_t cnt,
+              void *buffer)
+{
+  if (inode->metadata)
+    {
+      size_t i;
+
+      for (i = 0; i < cnt; i++)
+        journal_read (sector + i, (uint8_t *) buffer + i * BLOCK_SECTOR_SIZE);
+    }
+  else
+    block_read_multiple (fs_device, sector, cnt, buffer);
+}
+
+/* Writes BUFFER to the CNT sectors of INODE's data starting at
+   SECTOR. */
+static void
+write_sectors (struct inode *inode, block_sector_t sector, size_t cnt,
+               const void *buffer)
+{
+  if (inode->metadata)
+    {
+      size_t i;
+
+      for (i = 0; i < cnt; i++)
+        journal_write (sector + i,
+                       (const uint8_t *) buffer + i * BLOCK_SECTOR_SIZE);
+    }
+  else
+    block_write_multiple (fs_device, sector, cnt, buffer);
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
@@ -222,8 +276,12 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
+          /* Read full sectors directly into caller's buffer, all
+             at once, since a file's sectors are contiguous. */
+          off_t left = size < inode_left ? size : inode_left;
+          size_t cnt = left / BLOCK_SECTOR_SIZE;
+          read_sectors (inode, sector_idx, cnt, buffer + bytes_read);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
         }
       else 
         {
@@ -235,7 +293,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
               if (bounce == NULL)
                 break;
             }
-          block_read (fs_device, sector_idx, bounce);
+          read_sectors (inode, sector_idx, 1, bounce);
           memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
       
@@ -283,8 +341,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
+          /* Write full sectors directly to disk, all at once,
+             since a file's sectors are contiguous. */
+          off_t left = size < inode_left ? size : inode_left;
+          size_t cnt = left / BLOCK_SECTOR_SIZE;
+          write_sectors (inode, sector_idx, cnt, buffer + bytes_written);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
         }
       else 
         {
@@ -300,11 +362,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
              we're writing, then we need to read in the sector
              first.  Otherwise we start with a sector of all zeros. */
           if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
+            read_sectors (inode, sector_idx, 1, bounce);
           else
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
+          write_sectors (inode, sector_idx, 1, bounce);
         }
 
       /* Advance. */
@@ -0,0 +1,523 @@
+/* Write-ahead journal for file system metadata.
+
+   Without a journal, each metadata update (an inode, a
+   directory entry, the free map) goes straight to its home
+   sector, in whatever order the code happens to make them, so a
+   crash in the middle of creating or removing a file can leave,
+   for example, a directory entry that names an inode that was
+   never written.
+
+   Instead, metadata sectors written between journal_begin() and
+   journal_end() collect in memory, in the running transaction.
+   Committing the transaction writes all of its sectors, in
+   sector order, to the journal area after a descriptor that
+   lists their home sectors, followed by a commit record, and
+   only then copies them to their homes.  After a crash,
+   journal_init() copies a transaction whose commit record
+   reached the disk to its home sectors again, and ignores one
+   whose commit record did not, so either all of a transaction's
+   updates take effect or none of them.
+
+   Transactions are committed in groups.  The running
+   transaction stays open across many operations, absorbing
+   repeated writes to the same sector (the free map, a
+   directory), until an operation ends when it is at least
+   JOURNAL_COMMIT_MS old or too full to admit another, or until
+   journal_commit() is called, as by the fsync system call, or
+   the file system shuts down.  So that a transaction does not
+   stay open indefinitely once operations stop, a timer alarm
+   wakes the "journal" thread when it turns JOURNAL_COMMIT_MS
+   old, and the thread commits it if no operation is in
+   progress.
+
+   Every metadata write goes through the log.  journal_begin()
+   reserves JOURNAL_OP_SECTORS of log space for each operation,
+   and a new operation waits for a commit if the space is short,
+   so the running transaction can't fill up while operations are
+   writing to it.
+
+   File data does not go through the journal.  It is written
+   directly, before the metadata that refers to it is committed.
+   Sectors released during a transaction do not become free
+   until it commits (see free_map_release()), so that data
+   written to a new file cannot land on a sector that a crash
+   would give back to the file that had it before. */
+
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A transaction is committed when an operation ends if it is at
+   least this old, or if it has no room for another operation
+   (see has_room()). */
+#define JOURNAL_COMMIT_MS 5000
+#define COMMIT_TICKS (JOURNAL_COMMIT_MS * TIMER_FREQ / 1000)
+
+/* Journal area layout. */
+#define HEADER_SECTOR JOURNAL_SECTOR    /* Journal header. */
+#define DESC_SECTOR (JOURNAL_SECTOR + 1) /* Transaction descriptor. */
+#define LOG_SECTOR (JOURNAL_SECTOR + 2) /* Logged sectors, then the
+                                           commit record. */
+
+/* Identify the journal's records. */
+#define HEADER_MAGIC 0x4a484452         /* "JHDR" */
+#define DESC_MAGIC 0x4a445343           /* "JDSC" */
+#define COMMIT_MAGIC 0x4a434d54         /* "JCMT" */
+
+/* Journal header, transaction descriptor, or commit record.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+
+   The header gives the sequence number of the next transaction
+   to commit.  A descriptor and commit record with that number
+   describe a transaction that may not have reached its home
+   sectors yet; once it has, the header's number is advanced,
+   which retires them. */
+struct journal_record
+  {
+    unsigned magic;                     /* One of the magic numbers. */
+    uint32_t seq;                       /* Transaction sequence number. */
+    uint32_t cnt;                       /* Number of sectors logged. */
+    uint32_t checksum;                  /* Checksum of logged sectors. */
+    block_sector_t sectors[JOURNAL_MAX]; /* Home sectors, in log order. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 16 - 4 * JOURNAL_MAX];
+  };
+
+/* A metadata sector in the running transaction. */
+struct journal_entry
+  {
+    block_sector_t sector;              /* Home sector. */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Latest contents. */
+  };
+
+/* Protects all of the journal's state.  Held across the disk
+   writes of a commit, which also serializes commits. */
+static struct lock journal_lock;
+
+/* Signaled when the last operation in progress ends and when a
+   commit finishes. */
+static struct condition journal_cond;
+
+static struct journal_entry *entries;   /* Running transaction. */
+static size_t entry_cnt;                /* Number of entries in use. */
+static int64_t txn_start;               /* Tick of first write to it. */
+static int active_cnt;                  /* Operations in progress. */
+static bool committing;                 /* Commit in progress? */
+static uint32_t next_seq;               /* Number of next commit. */
+static struct timer_alarm commit_alarm; /* Goes off when TXN_START is
+                                           COMMIT_TICKS old. */
+static struct semaphore commit_due;     /* Upped by COMMIT_ALARM. */
+static struct journal_record *record;   /* Record being read or written. */
+static uint8_t *stage;                  /* Sectors being written in a run:
+                                           descriptor and log, or
+                                           adjacent home sectors. */
+
+/* Statistics. */
+static unsigned commit_cnt;             /* Transactions committed. */
+static unsigned logged_cnt;             /* Sectors written to the log. */
+static unsigned absorbed_cnt;           /* Writes to a logged sector. */
+
+static thread_func commit_thread;
+static bool has_room (int op_cnt);
+static void commit (void);
+static void replay (void);
+static void checkpoint (void);
+static void write_header (void);
+static struct journal_entry *lookup (block_sector_t);
+static uint32_t checksum (void);
+static int compare_entries (const void *, const void *);
+
+/* Initializes the journal.  If FORMAT is true, starts a new,
+   empty journal.  Otherwise, replays the last transaction that
+   was committed but may not have been copied to its home
+   sectors.  Must be called before anything else reads file
+   system metadata. */
+void
+journal_init (bool format)
+{
+  ASSERT (sizeof *record == BLOCK_SECTOR_SIZE);
+
+  lock_init (&journal_lock);
+  cond_init (&journal_cond);
+  entries = malloc (JOURNAL_MAX * sizeof *entries);
+  record = malloc (sizeof *record);
+  stage = malloc ((JOURNAL_MAX + 1) * BLOCK_SECTOR_SIZE);
+  if (entries == NULL || record == NULL || stage == NULL)
+    PANIC ("can't allocate journal");
+
+  if (format)
+    next_seq = 1;
+  else
+    {
+      block_read (fs_device, HEADER_SECTOR, record);
+      if (record->magic != HEADER_MAGIC)
+        PANIC ("file system has no journal--reformat it with -f");
+      next_seq = record->seq;
+      replay ();
+    }
+  write_header ();
+
+  timer_alarm_init (&commit_alarm);
+  sema_init (&commit_due, 0);
+  if (thread_create ("journal", PRI_DEFAULT, commit_thread, NULL)
+      == TID_ERROR)
+    PANIC ("can't start journal thread");
+}
+
+/* Commits the running transaction, if any, before the file
+   system shuts down.  The disk needs interrupts, so with them
+   off, as after a kernel panic, the transaction is lost, just as
+   it would be in a crash. */
+void
+journal_done (void)
+{
+  if (intr_get_level () == INTR_ON)
+    journal_commit ();
+}
+
+/* Starts an operation whose metadata writes must all reach the
+   disk or none of them.  Each call must be paired with a call
+   to journal_end() by the same thread, and calls must not
+   nest. */
+void
+journal_begin (void)
+{
+  lock_acquire (&journal_lock);
+  for (;;)
+    if (committing)
+      cond_wait (&journal_cond, &journal_lock);
+    else if (!has_room (active_cnt + 1))
+      {
+        /* Not enough log space for one more operation.  Commit
+           once those in progress end. */
+        if (active_cnt == 0)
+          commit ();
+        else
+          cond_wait (&journal_cond, &journal_lock);
+      }
+    else
+      break;
+  active_cnt++;
+  lock_release (&journal_lock);
+}
+
+/* Ends an operation started with journal_begin().  Commits the
+   running transaction if this was the last operation in progress
+   and the transaction is old enough or too full for another
+   operation. */
+void
+journal_end (void)
+{
+  lock_acquire (&journal_lock);
+  ASSERT (active_cnt > 0);
+  active_cnt--;
+  cond_broadcast (&journal_cond, &journal_lock);
+  if (active_cnt == 0 && !committing && entry_cnt > 0
+      && (timer_elapsed (txn_start) >= COMMIT_TICKS || !has_room (1)))
+    commit ();
+  lock_release (&journal_lock);
+}
+
+/* Commits the running transaction, so that every operation that
+   has ended is on disk.  Must not be called by a thread between
+   journal_begin() and journal_end(). */
+void
+journal_commit (void)
+{
+  lock_acquire (&journal_lock);
+  if (!committing)
+    commit ();
+  else
+    {
+      /* The commit in progress already includes every operation
+         that has ended. */
+      while (committing)
+        cond_wait (&journal_cond, &journal_lock);
+    }
+  lock_release (&journal_lock);
+}
+
+/* Reads metadata SECTOR into BUFFER, which must have room for
+   BLOCK_SECTOR_SIZE bytes, from the running transaction if it
+   has written the sector, otherwise from disk. */
+void
+journal_read (block_sector_t sector, void *buffer)
+{
+  struct journal_entry *e;
+
+  lock_acquire (&journal_lock);
+  e = lookup (sector);
+  if (e != NULL)
+    memcpy (buffer, e->data, BLOCK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+
+  if (e == NULL)
+    block_read (fs_device, sector, buffer);
+}
+
+/* Writes BLOCK_SECTOR_SIZE bytes from BUFFER to metadata SECTOR
+   as part of the running transaction.  Must be called between
+   journal_begin() and journal_end(). */
+void
+journal_write (block_sector_t sector, const void *buffer)
+{
+  struct journal_entry *e;
+
+  lock_acquire (&journal_lock);
+  ASSERT (active_cnt > 0 || committing);
+
+  e = lookup (sector);
+  if (e != NULL)
+    absorbed_cnt++;
+  else
+    {
+      /* journal_begin() reserved room for this write, unless the
+         operation wrote more than JOURNAL_OP_SECTORS sectors. */
+      ASSERT (entry_cnt < JOURNAL_MAX);
+      if (entry_cnt == 0)
+        {
+          txn_start = timer_ticks ();
+          timer_alarm_set (&commit_alarm, txn_start + COMMIT_TICKS,
+                           &commit_due);
+        }
+      e = &entries[entry_cnt++];
+      e->sector = sector;
+    }
+  memcpy (e->data, buffer, BLOCK_SECTOR_SIZE);
+  lock_release (&journal_lock);
+}
+
+/* Drops any writes to the CNT sectors starting at SECTOR from
+   the running transaction, because those sectors have been
+   freed and their contents no longer matter. */
+void
+journal_forget (block_sector_t sector, size_t cnt)
+{
+  size_t i;
+
+  lock_acquire (&journal_lock);
+  for (i = 0; i < entry_cnt; )
+    if (entries[i].sector - sector < cnt)
+      entries[i] = entries[--entry_cnt];
+    else
+      i++;
+  lock_release (&journal_lock);
+}
+
+/* Prints journal statistics. */
+void
+journal_print_stats (void)
+{
+  printf ("Journal: %u commits, %u sectors logged, %u writes absorbed\n",
+          commit_cnt, logged_cnt, absorbed_cnt);
+}
+
+/* Commits the running transaction once it is COMMIT_TICKS old,
+   if no operation is in progress then.  If one is, the last one
+   to end commits it in journal_end().  Sleeps on COMMIT_DUE in
+   between, without polling. */
+static void
+commit_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      sema_down (&commit_due);
+      lock_acquire (&journal_lock);
+      /* The transaction that set the alarm may have been
+         committed already.  A younger one set the alarm again
+         when it started. */
+      if (entry_cnt > 0 && active_cnt == 0 && !committing
+          && timer_elapsed (txn_start) >= COMMIT_TICKS)
+        commit ();
+      lock_release (&journal_lock);
+    }
+}
+
+/* Returns true if the running transaction has room for OP_CNT
+   operations, each adding up to JOURNAL_OP_SECTORS sectors, and
+   then for commit() to add the free map.  Counts the sectors
+   that operations in progress have already added twice, which
+   errs on the safe side. */
+static bool
+has_room (int op_cnt)
+{
+  return entry_cnt + (op_cnt + 1) * JOURNAL_OP_SECTORS <= JOURNAL_MAX;
+}
+
+/* Commits the running transaction.  The caller must hold
+   JOURNAL_LOCK and must not have an operation in progress. */
+static void
+commit (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  ASSERT (!committing);
+
+  /* Keep new operations out and wait for the ones in progress to
+     end. */
+  committing = true;
+  while (active_cnt > 0)
+    cond_wait (&journal_cond, &journal_lock);
+
+  /* Sectors released during the transaction become free as part
+     of it.  That writes the free map, which takes the lock. */
+  lock_release (&journal_lock);
+  free_map_commit ();
+  lock_acquire (&journal_lock);
+
+  if (entry_cnt > 0)
+    {
+      qsort (entries, entry_cnt, sizeof *entries, compare_entries);
+
+      /* Log the transaction's sectors after a descriptor, all in
+         one write, since they are adjacent... */
+      memset (record, 0, sizeof *record);
+      record->magic = DESC_MAGIC;
+      record->seq = next_seq;
+      record->cnt = entry_cnt;
+      for (i = 0; i < entry_cnt; i++)
+        record->sectors[i] = entries[i].sector;
+      memcpy (stage, record, BLOCK_SECTOR_SIZE);
+      for (i = 0; i < entry_cnt; i++)
+        memcpy (stage + (i + 1) * BLOCK_SECTOR_SIZE, entries[i].data,
+                BLOCK_SECTOR_SIZE);
+      block_write_multiple (fs_device, DESC_SECTOR, entry_cnt + 1, stage);
+
+      /* ...then commit it, only once the log is on disk... */
+      record->magic = COMMIT_MAGIC;
+      record->checksum = checksum ();
+      block_write (fs_device, LOG_SECTOR + entry_cnt, record);
+
+      /* ...then copy it home and retire it. */
+      checkpoint ();
+      next_seq++;
+      write_header ();
+
+      commit_cnt++;
+      logged_cnt += entry_cnt;
+      entry_cnt = 0;
+    }
+
+  committing = false;
+  cond_broadcast (&journal_cond, &journal_lock);
+}
+
+/* Reads the transaction numbered NEXT_SEQ from the log into
+   ENTRIES and, if its commit record is intact, copies it to its
+   home sectors and retires it. */
+static void
+replay (void)
+{
+  size_t i;
+
+  block_read (fs_device, DESC_SECTOR, record);
+  if (record->magic != DESC_MAGIC || record->seq != next_seq
+      || record->cnt > JOURNAL_MAX)
+    return;
+
+  /* The log holds the sectors in the order that commit() sorted
+     them into, as checkpoint() requires. */
+  entry_cnt = record->cnt;
+  block_read_multiple (fs_device, LOG_SECTOR, entry_cnt, stage);
+  for (i = 0; i < entry_cnt; i++)
+    {
+      entries[i].sector = record->sectors[i];
+      memcpy (entries[i].data, stage + i * BLOCK_SECTOR_SIZE,
+              BLOCK_SECTOR_SIZE);
+    }
+
+  block_read (fs_device, LOG_SECTOR + entry_cnt, record);
+  if (record->magic == COMMIT_MAGIC && record->seq == next_seq
+      && record->cnt == entry_cnt && record->checksum == checksum ())
+    {
+      printf ("Replaying journal...");
+      checkpoint ();
+      next_seq++;
+      printf ("%zu sectors.\n", entry_cnt);
+    }
+  entry_cnt = 0;
+}
+
+/* Writes each sector in ENTRIES, which must be sorted by
+   sector, to its home sector.  Runs of adjacent home sectors go
+   out in one write each. */
+static void
+checkpoint (void)
+{
+  size_t i, cnt;
+
+  for (i = 0; i < entry_cnt; i += cnt)
+    {
+      for (cnt = 1; i + cnt < entry_cnt; cnt++)
+        if (entries[i + cnt].sector != entries[i].sector + cnt)
+          break;
+      if (cnt == 1)
+        block_write (fs_device, entries[i].sector, entries[i].data);
+      else
+        {
+          size_t j;
+
+          for (j = 0; j < cnt; j++)
+            memcpy (stage + j * BLOCK_SECTOR_SIZE, entries[i + j].data,
+                    BLOCK_SECTOR_SIZE);
+          block_write_multiple (fs_device, entries[i].sector, cnt, stage);
+        }
+    }
+}
+
+/* Writes the journal header. */
+static void
+write_header (void)
+{
+  memset (record, 0, sizeof *record);
+  record->magic = HEADER_MAGIC;
+  record->seq = next_seq;
+  block_write (fs_device, HEADER_SECTOR, record);
+}
+
+/* Returns the entry for SECTOR in the running transaction, or a
+   null pointer if it has not written SECTOR. */
+static struct journal_entry *
+lookup (block_sector_t sector)
+{
+  size_t i;
+
+  for (i = 0; i < entry_cnt; i++)
+    if (entries[i].sector == sector)
+      return &entries[i];
+  return NULL;
+}
+
+/* Returns a checksum of the ENTRY_CNT sectors in ENTRIES and
+   their home sector numbers. */
+static uint32_t
+checksum (void)
+{
+  uint32_t sum = 0;
+  size_t i;
+
+  for (i = 0; i < entry_cnt; i++)
+    sum = sum * 31 + hash_bytes (&entries[i], sizeof entries[i]);
+  return sum;
+}
+
+/* Orders journal entries by home sector. */
+static int
+compare_entries (const void *a_, const void *b_)
+{
+  const struct journal_entry *a = a_;
+  const struct journal_entry *b = b_;
+
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
@@ -0,0 +1,38 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Number of sectors reserved for the journal, starting at
+   JOURNAL_SECTOR (see filesys.h).  One holds the journal header,
+   and two more the descriptor and commit record of a
+   transaction, which leaves room for JOURNAL_MAX metadata
+   sectors in each transaction. */
+#define JOURNAL_SECTORS 64
+#define JOURNAL_MAX (JOURNAL_SECTORS - 3)
+
+/* Most sectors that one operation between journal_begin() and
+   journal_end() may add to the running transaction: the free
+   map, which free_map_init() limits to JOURNAL_FREE_MAP_SECTORS,
+   plus an inode, a directory entry that may straddle two
+   sectors, and one to spare.  journal_begin() reserves this much
+   room for each operation. */
+#define JOURNAL_FREE_MAP_SECTORS 4
+#define JOURNAL_OP_SECTORS (JOURNAL_FREE_MAP_SECTORS + 4)
+
+void journal_init (bool format);
+void journal_done (void);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_commit (void);
+
+void journal_read (block_sector_t, void *);
+void journal_write (block_sector_t, const void *);
+void journal_forget (block_sector_t, size_t);
+
+void journal_print_stats (void);
+
+#endif /* filesys/journal.h */
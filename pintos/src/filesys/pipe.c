@@ -0,0 +1,200 @@
+#include "filesys/pipe.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* An anonymous pipe: a ring buffer of one or more pages shared
+   by the files that form its read and write ends.
+
+   Readers block while the pipe is empty and some writer remains;
+   a read from an empty pipe with no writers returns 0, that is,
+   end of file.  Writers block while the pipe is full and some
+   reader remains; a write to a pipe with no readers fails.
+
+   Data is moved with at most two memcpy() calls per wakeup, one
+   on each side of the point where the ring wraps around. */
+struct pipe
+  {
+    struct lock lock;           /* Protects all members below. */
+    struct condition not_empty; /* Signaled when data is added. */
+    struct condition not_full;  /* Signaled when data is removed. */
+
+    uint8_t *buf;               /* Ring buffer. */
+    size_t page_cnt;            /* Size of BUF, in pages. */
+    size_t size;                /* Size of BUF, in bytes. */
+    size_t ofs;                 /* Offset of oldest byte in BUF. */
+    size_t used;                /* Number of bytes in BUF. */
+
+    int reader_cnt;             /* Number of open read ends. */
+    int writer_cnt;             /* Number of open write ends. */
+  };
+
+/* Creates and returns a new pipe whose buffer is PAGE_CNT pages
+   long, with no open ends.  The pipe is freed when its last end
+   is closed.  Returns a null pointer if memory
+   cannot be allocated. */
+struct pipe *
+pipe_create (size_t page_cnt)
+{
+  struct pipe *pipe;
+
+  ASSERT (page_cnt > 0);
+
+  pipe = malloc (sizeof *pipe);
+  if (pipe == NULL)
+    return NULL;
+
+  pipe->buf = palloc_get_multiple (0, page_cnt);
+  if (pipe->buf == NULL)
+    {
+      free (pipe);
+      return NULL;
+    }
+
+  lock_init (&pipe->lock);
+  cond_init (&pipe->not_empty);
+  cond_init (&pipe->not_full);
+  pipe->page_cnt = page_cnt;
+  pipe->size = page_cnt * PGSIZE;
+  pipe->ofs = pipe->used = 0;
+  pipe->reader_cnt = pipe->writer_cnt = 0;
+  return pipe;
+}
+
+/* Records that a new read end (if WRITER is false) or write end
+   (if WRITER is true) of PIPE has been opened. */
+void
+pipe_open_end (struct pipe *pipe, bool writer)
+{
+  lock_acquire (&pipe->lock);
+  if (writer)
+    pipe->writer_cnt++;
+  else
+    pipe->reader_cnt++;
+  lock_release (&pipe->lock);
+}
+
+/* Closes a read end (if WRITER is false) or write end (if WRITER
+   is true) of PIPE.  Wakes up any threads that are waiting for
+   the other end, so that readers see end of file and writers
+   see failure.  Frees PIPE when its last end is closed. */
+void
+pipe_close_end (struct pipe *pipe, bool writer)
+{
+  bool dead;
+
+  lock_acquire (&pipe->lock);
+  if (writer)
+    {
+      ASSERT (pipe->writer_cnt > 0);
+      pipe->writer_cnt--;
+      cond_broadcast (&pipe->not_empty, &pipe->lock);
+    }
+  else
+    {
+      ASSERT (pipe->reader_cnt > 0);
+      pipe->reader_cnt--;
+      cond_broadcast (&pipe->not_full, &pipe->lock);
+    }
+  dead = pipe->reader_cnt == 0 && pipe->writer_cnt == 0;
+  lock_release (&pipe->lock);
+
+  if (dead)
+    pipe_destroy (pipe);
+}
+
+/* Frees PIPE, which must have no open ends.  This only needs to
+   be called directly for a pipe whose ends were never opened;
+   otherwise pipe_close_end() calls it. */
+void
+pipe_destroy (struct pipe *pipe)
+{
+  ASSERT (pipe->reader_cnt == 0 && pipe->writer_cnt == 0);
+  palloc_free_multiple (pipe->buf, pipe->page_cnt);
+  free (pipe);
+}
+
+/* Reads up to SIZE bytes from PIPE into BUFFER.  Waits until at
+   least one byte is available or no write end remains open.
+   Returns the number of bytes read, which is 0 only at end of
+   file or if SIZE is 0, or -1 if the wait is interrupted (see
+   thread_interrupt()). */
+off_t
+pipe_read (struct pipe *pipe, void *buffer, off_t size)
+{
+  size_t chunk;
+
+  if (size <= 0)
+    return 0;
+
+  lock_acquire (&pipe->lock);
+  while (pipe->used == 0 && pipe->writer_cnt > 0)
+    if (!cond_wait_interruptible (&pipe->not_empty, &pipe->lock))
+      {
+        lock_release (&pipe->lock);
+        return -1;
+      }
+
+  if ((size_t) size > pipe->used)
+    size = pipe->used;
+
+  chunk = pipe->size - pipe->ofs;
+  if (chunk > (size_t) size)
+    chunk = size;
+  memcpy (buffer, pipe->buf + pipe->ofs, chunk);
+  memcpy ((uint8_t *) buffer + chunk, pipe->buf, size - chunk);
+  pipe->ofs = (pipe->ofs + size) % pipe->size;
+  pipe->used -= size;
+
+  if (size > 0)
+    cond_broadcast (&pipe->not_full, &pipe->lock);
+  lock_release (&pipe->lock);
+
+  return size;
+}
+
+/* Writes SIZE bytes from BUFFER into PIPE, waiting for room as
+   necessary.  Returns the number of bytes written, which is less
+   than SIZE only if every read end is closed in the meantime or
+   the wait is interrupted (see thread_interrupt()).  Returns -1
+   if nothing was written for either reason. */
+off_t
+pipe_write (struct pipe *pipe, const void *buffer, off_t size)
+{
+  const uint8_t *src = buffer;
+  off_t written = 0;
+
+  lock_acquire (&pipe->lock);
+  while (written < size)
+    {
+      size_t room, ofs, chunk, n;
+
+      while (pipe->used == pipe->size && pipe->reader_cnt > 0)
+        if (!cond_wait_interruptible (&pipe->not_full, &pipe->lock))
+          break;
+      if (pipe->reader_cnt == 0 || pipe->used == pipe->size)
+        break;
+
+      room = pipe->size - pipe->used;
+      n = size - written;
+      if (n > room)
+        n = room;
+
+      ofs = (pipe->ofs + pipe->used) % pipe->size;
+      chunk = pipe->size - ofs;
+      if (chunk > n)
+        chunk = n;
+      memcpy (pipe->buf + ofs, src + written, chunk);
+      memcpy (pipe->buf, src + written + chunk, n - chunk);
+      pipe->used += n;
+      written += n;
+
+      cond_broadcast (&pipe->not_empty, &pipe->lock);
+    }
+  lock_release (&pipe->lock);
+
+  return written == 0 && size > 0 ? -1 : written;
+}
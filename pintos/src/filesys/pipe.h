@@ -0,0 +1,22 @@
+#ifndef FILESYS_PIPE_H
+#define FILESYS_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+/* Number of pages in the ring buffer of a pipe created by the
+   pipe system call. */
+#define PIPE_PAGE_CNT 1
+
+struct pipe;
+
+struct pipe *pipe_create (size_t page_cnt);
+void pipe_open_end (struct pipe *, bool writer);
+void pipe_close_end (struct pipe *, bool writer);
+void pipe_destroy (struct pipe *);
+
+off_t pipe_read (struct pipe *, void *, off_t);
+off_t pipe_write (struct pipe *, const void *, off_t);
+
+#endif /* filesys/pipe.h */
@@ -0,0 +1,70 @@
+#ifndef __LIB_AIO_H
+#define __LIB_AIO_H
+
+/* Asynchronous I/O ring, shared between a user process and the
+   kernel.
+
+   The process registers a struct io_ring in its own memory with
+   io_setup(), which the kernel then reads and writes directly.
+   To start I/O, the process fills in entries of the submission
+   queue, advances SQ_TAIL past them, and calls io_submit().  The
+   kernel takes the entries, advancing SQ_HEAD, and hands them to
+   kernel worker threads.  As each request finishes, in whatever
+   order, the kernel fills in an entry of the completion queue
+   and advances CQ_TAIL.  The process reads completions, advancing
+   CQ_HEAD past them, whenever it likes, and calls io_wait() to
+   sleep until there are enough.
+
+   Indexes count up without wrapping around; entry I of a queue
+   is at index I % IO_RING_ENTRIES.  A queue is empty when its
+   head equals its tail.
+
+   The kernel never has more requests in flight than there is
+   room for in the completion queue, so io_submit() may take
+   fewer entries than are waiting if the process is slow to
+   consume completions.
+
+   A ring must not cross a page boundary, which aligning it to
+   2048 bytes ensures, and the buffers of requests in flight
+   must stay mapped until the requests complete. */
+
+/* Number of entries in each queue.  Must be a power of 2. */
+#define IO_RING_ENTRIES 32
+
+/* Operations. */
+enum io_op
+  {
+    IO_READ,                    /* Read from a file. */
+    IO_WRITE                    /* Write to a file. */
+  };
+
+/* Submission queue entry. */
+struct io_sqe
+  {
+    int op;                     /* An enum io_op. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* Buffer in user memory. */
+    unsigned size;              /* Number of bytes to transfer. */
+    unsigned offset;            /* Position in file. */
+    unsigned user_data;         /* Passed back in the completion. */
+  };
+
+/* Completion queue entry. */
+struct io_cqe
+  {
+    unsigned user_data;         /* From the submission. */
+    int result;                 /* Bytes transferred, or -1 on error. */
+  };
+
+/* Submission and completion queues. */
+struct io_ring
+  {
+    unsigned sq_head;           /* Next entry the kernel will take. */
+    unsigned sq_tail;           /* Next entry the process will fill. */
+    unsigned cq_head;           /* Next entry the process will read. */
+    unsigned cq_tail;           /* Next entry the kernel will fill. */
+    struct io_sqe sqes[IO_RING_ENTRIES];
+    struct io_cqe cqes[IO_RING_ENTRIES];
+  };
+
+#endif /* lib/aio.h */
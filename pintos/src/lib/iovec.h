@@ -0,0 +1,17 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* One buffer in a scatter/gather list, as passed to readv() and
+   writev(). */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer in bytes. */
+  };
+
+/* Most buffers that readv() and writev() accept at once. */
+#define IOV_MAX 16
+
+#endif /* lib/iovec.h */
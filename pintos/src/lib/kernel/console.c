@@ -9,6 +9,7 @@
 
 static void vprintf_helper (char, void *);
 static void putchar_have_lock (uint8_t c);
+static void putbuf_have_lock (const char *buffer, size_t n);
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -119,19 +120,31 @@ console_locked_by_current_thread (void)
           || lock_held_by_current_thread (&console_lock));
 }
 
+/* Auxiliary data for vprintf_helper(). */
+struct vprintf_aux 
+  {
+    int char_cnt;               /* Number of characters output. */
+    size_t len;                 /* Number of characters in BUF. */
+    char buf[64];               /* Output not yet written. */
+  };
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list.
    Writes its output to both vga display and serial port. */
 int
 vprintf (const char *format, va_list args) 
 {
-  int char_cnt = 0;
+  struct vprintf_aux aux;
+
+  aux.char_cnt = 0;
+  aux.len = 0;
 
   acquire_console ();
-  __vprintf (format, args, vprintf_helper, &char_cnt);
+  __vprintf (format, args, vprintf_helper, &aux);
+  putbuf_have_lock (aux.buf, aux.len);
   release_console ();
 
-  return char_cnt;
+  return aux.char_cnt;
 }
 
 /* Writes string S to the console, followed by a new-line
@@ -153,8 +166,20 @@ void
 putbuf (const char *buffer, size_t n) 
 {
   acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
+  putbuf_have_lock (buffer, n);
+  release_console ();
+}
+
+/* Writes the CNT buffers in IOV to the console, in order,
+   without letting any other output come between them. */
+void
+putbufv (const struct iovec *iov, size_t cnt)
+{
+  size_t i;
+
+  acquire_console ();
+  for (i = 0; i < cnt; i++)
+    putbuf_have_lock (iov[i].iov_base, iov[i].iov_len);
   release_console ();
 }
 
@@ -169,13 +194,19 @@ putchar (int c)
   return c;
 }
 
-/* Helper function for vprintf(). */
+/* Helper function for vprintf().
+   Collects characters in AUX_ and writes them out in bulk. */
 static void
-vprintf_helper (char c, void *char_cnt_) 
+vprintf_helper (char c, void *aux_) 
 {
-  int *char_cnt = char_cnt_;
-  (*char_cnt)++;
-  putchar_have_lock (c);
+  struct vprintf_aux *aux = aux_;
+  aux->char_cnt++;
+  aux->buf[aux->len++] = c;
+  if (aux->len >= sizeof aux->buf) 
+    {
+      putbuf_have_lock (aux->buf, aux->len);
+      aux->len = 0;
+    }
 }
 
 /* Writes C to the vga display and serial port.
@@ -189,3 +220,16 @@ putchar_have_lock (uint8_t c)
   serial_putc (c);
   vga_putc (c);
 }
+
+/* Writes the N characters in BUFFER to the vga display and
+   serial port, each in a single bulk operation.
+   The caller has already acquired the console lock if
+   appropriate. */
+static void
+putbuf_have_lock (const char *buffer, size_t n) 
+{
+  ASSERT (console_locked_by_current_thread ());
+  write_cnt += n;
+  serial_putbuf (buffer, n);
+  vga_putbuf (buffer, n);
+}
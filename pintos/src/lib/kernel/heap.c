@@ -0,0 +1,203 @@
+/* Binary heap.
+
+   See heap.h for basic information.
+
+   The heap is stored in an array in the usual way: the children
+   of the element at index I are at 2*I + 1 and 2*I + 2, and no
+   element is less than its parent, so the least element is at
+   index 0. */
+
+#include "heap.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Number of elements in a heap's first array. */
+#define MIN_CAPACITY 16
+
+static void sift_up (struct heap *, size_t idx);
+static void sift_down (struct heap *, size_t idx);
+
+/* Initializes H as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->elems = NULL;
+  h->elem_cnt = 0;
+  h->capacity = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Makes sure that H has room for CNT elements, so that pushing
+   up to that many will not need to allocate memory.  Returns
+   true if successful, false if memory is not available. */
+bool
+heap_reserve (struct heap *h, size_t cnt)
+{
+  struct heap_elem **elems;
+  size_t capacity;
+
+  if (cnt <= h->capacity)
+    return true;
+
+  capacity = h->capacity > 0 ? h->capacity : MIN_CAPACITY;
+  while (capacity < cnt)
+    capacity *= 2;
+  elems = realloc (h->elems, sizeof *elems * capacity);
+  if (elems == NULL)
+    return false;
+  h->elems = elems;
+  h->capacity = capacity;
+  return true;
+}
+
+/* Frees the memory used by H, which need not be empty.  Does not
+   touch H's elements. */
+void
+heap_destroy (struct heap *h)
+{
+  free (h->elems);
+  h->elems = NULL;
+  h->elem_cnt = h->capacity = 0;
+}
+
+/* Inserts E into H.  Returns true if successful, false if H had
+   to grow and memory was not available. */
+bool
+heap_push (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (e != NULL);
+
+  if (!heap_reserve (h, h->elem_cnt + 1))
+    return false;
+  e->idx = h->elem_cnt++;
+  h->elems[e->idx] = e;
+  sift_up (h, e->idx);
+  return true;
+}
+
+/* Returns the least element in H, which must not be empty,
+   without removing it. */
+struct heap_elem *
+heap_top (struct heap *h)
+{
+  ASSERT (!heap_empty (h));
+  return h->elems[0];
+}
+
+/* Removes and returns the least element in H, which must not be
+   empty. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *top = heap_top (h);
+
+  heap_remove (h, top);
+  return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  size_t idx = e->idx;
+  struct heap_elem *last;
+
+  ASSERT (idx < h->elem_cnt && h->elems[idx] == e);
+
+  /* Fill the hole with the last element and move it up or down
+     to where it belongs. */
+  last = h->elems[--h->elem_cnt];
+  if (last != e)
+    {
+      h->elems[idx] = last;
+      last->idx = idx;
+      heap_update (h, last);
+    }
+}
+
+/* Restores the order of H after element E, which must be in H,
+   has become less than it was. */
+void
+heap_decrease_key (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (e->idx < h->elem_cnt && h->elems[e->idx] == e);
+  sift_up (h, e->idx);
+}
+
+/* Restores the order of H after element E, which must be in H,
+   has changed in either direction. */
+void
+heap_update (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (e->idx < h->elem_cnt && h->elems[e->idx] == e);
+  sift_up (h, e->idx);
+  sift_down (h, e->idx);
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (struct heap *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+heap_empty (struct heap *h)
+{
+  return h->elem_cnt == 0;
+}
+
+/* Puts element E in H at index IDX. */
+static inline void
+place (struct heap *h, struct heap_elem *e, size_t idx)
+{
+  h->elems[idx] = e;
+  e->idx = idx;
+}
+
+/* Moves the element at index IDX in H toward the top until it
+   is not less than its parent. */
+static void
+sift_up (struct heap *h, size_t idx)
+{
+  struct heap_elem *e = h->elems[idx];
+
+  while (idx > 0)
+    {
+      size_t parent = (idx - 1) / 2;
+      if (!h->less (e, h->elems[parent], h->aux))
+        break;
+      place (h, h->elems[parent], idx);
+      idx = parent;
+    }
+  place (h, e, idx);
+}
+
+/* Moves the element at index IDX in H toward the bottom until
+   neither of its children is less than it. */
+static void
+sift_down (struct heap *h, size_t idx)
+{
+  struct heap_elem *e = h->elems[idx];
+
+  for (;;)
+    {
+      size_t child = 2 * idx + 1;
+      if (child >= h->elem_cnt)
+        break;
+      if (child + 1 < h->elem_cnt
+          && h->less (h->elems[child + 1], h->elems[child], h->aux))
+        child++;
+      if (!h->less (h->elems[child], e, h->aux))
+        break;
+      place (h, h->elems[child], idx);
+      idx = child;
+    }
+  place (h, e, idx);
+}
@@ -0,0 +1,93 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Binary heap (priority queue).
+
+   A heap keeps its elements partially ordered by a comparison
+   function so that the least element is always at hand:
+   heap_top() is O(1), and heap_push(), heap_pop(), and removing
+   or reordering an arbitrary element are O(log n).  Compare
+   list_insert_ordered(), which is O(n).
+
+   Like a list, a heap does not allocate its elements.  Each
+   structure that can be in a heap embeds a struct heap_elem
+   member, and heap_entry() converts a struct heap_elem back to
+   the structure that contains it, just as list_entry() does for
+   lists (see list.h).  For example:
+
+      struct foo
+        {
+          struct heap_elem elem;
+          int priority;
+          ...other members...
+        };
+
+   The heap itself is an array of pointers to elements, which
+   heap_push() grows with malloc() as needed.  Code that cannot
+   allocate memory, such as an interrupt handler, can call
+   heap_reserve() beforehand.  Each element records its own
+   position in the array, which is what lets heap_remove() and
+   heap_update() find it without searching.
+
+   An element may be in only one heap at a time.  Changing the
+   part of an element that the comparison function looks at
+   while it is in a heap breaks the heap, unless heap_update()
+   or heap_decrease_key() is called right away. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    size_t idx;                 /* Position in the heap's array. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element.  See the big comment at the top of the
+   file for an example. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->idx      \
+                     - offsetof (STRUCT, MEMBER.idx)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B.  The least element
+   is at the top of the heap. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Binary heap. */
+struct heap
+  {
+    struct heap_elem **elems;   /* Array of `elem_cnt' elements. */
+    size_t elem_cnt;            /* Number of elements. */
+    size_t capacity;            /* Number of elements ELEMS has room for. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+/* Basic life cycle. */
+void heap_init (struct heap *, heap_less_func *, void *aux);
+bool heap_reserve (struct heap *, size_t cnt);
+void heap_destroy (struct heap *);
+
+/* Insertion and removal. */
+bool heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+/* Reordering. */
+void heap_decrease_key (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+/* Information. */
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
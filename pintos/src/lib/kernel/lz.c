@@ -0,0 +1,216 @@
+/* Fast LZ77-style compression.
+
+   See lz.h for basic information. */
+
+#include "lz.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "../debug.h"
+
+/* Number of hash table entries, as a power of 2. */
+#define HASH_BITS 10
+
+/* Largest count that fits in half of a token byte.  A count this
+   big continues in the bytes that follow. */
+#define TOKEN_MAX 15
+
+/* Largest distance back that a copy can reach. */
+#define MAX_DISTANCE 0xffff
+
+/* Returns the 4 bytes at P as a 32-bit integer. */
+static inline uint32_t
+read32 (const uint8_t *p)
+{
+  uint32_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+/* Returns the hash table index for 4-byte sequence SEQ. */
+static inline size_t
+hash_seq (uint32_t seq)
+{
+  return (seq * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Appends the continuation bytes for count LEN, which is at
+   least TOKEN_MAX, to the output at OP, which ends at OEND.
+   Returns the new end of output, or a null pointer if it did
+   not fit. */
+static uint8_t *
+put_count (uint8_t *op, uint8_t *oend, size_t len)
+{
+  for (len -= TOKEN_MAX; len >= 255; len -= 255)
+    {
+      if (op >= oend)
+        return NULL;
+      *op++ = 255;
+    }
+  if (op >= oend)
+    return NULL;
+  *op++ = len;
+  return op;
+}
+
+/* Appends a sequence to the output at OP, which ends at OEND:
+   the LIT_LEN literal bytes at LIT, followed, unless MATCH_LEN
+   is 0, by a copy of MATCH_LEN bytes from DISTANCE bytes back.
+   Returns the new end of output, or a null pointer if it did
+   not fit. */
+static uint8_t *
+put_sequence (uint8_t *op, uint8_t *oend, const uint8_t *lit,
+              size_t lit_len, size_t distance, size_t match_len)
+{
+  size_t extra = match_len > 0 ? match_len - LZ_MIN_MATCH : 0;
+  uint8_t *token;
+
+  if (op >= oend)
+    return NULL;
+  token = op++;
+  *token = ((lit_len < TOKEN_MAX ? lit_len : TOKEN_MAX) << 4
+            | (extra < TOKEN_MAX ? extra : TOKEN_MAX));
+
+  if (lit_len >= TOKEN_MAX && (op = put_count (op, oend, lit_len)) == NULL)
+    return NULL;
+  if ((size_t) (oend - op) < lit_len)
+    return NULL;
+  memcpy (op, lit, lit_len);
+  op += lit_len;
+
+  if (match_len > 0)
+    {
+      if (oend - op < 2)
+        return NULL;
+      *op++ = distance & 0xff;
+      *op++ = distance >> 8;
+      if (extra >= TOKEN_MAX && (op = put_count (op, oend, extra)) == NULL)
+        return NULL;
+    }
+  return op;
+}
+
+/* Compresses the SRC_SIZE bytes at SRC, which must be no more
+   than LZ_MAX_INPUT, into the DST_SIZE bytes at DST, using the
+   LZ_WORK_SIZE bytes at WORK as scratch space.  Returns the size
+   of the compressed data, or 0 if it would not fit in DST_SIZE
+   bytes. */
+size_t
+lz_compress (void *dst, size_t dst_size, const void *src, size_t src_size,
+             void *work)
+{
+  const uint8_t *base = src;
+  const uint8_t *end = base + src_size;
+  const uint8_t *ip = base;
+  const uint8_t *anchor = base;
+  uint8_t *op = dst;
+  uint8_t *oend = op + dst_size;
+  uint16_t *table = work;
+
+  ASSERT (src_size <= LZ_MAX_INPUT);
+  ASSERT (sizeof *table << HASH_BITS <= LZ_WORK_SIZE);
+
+  /* Entries start out pointing at the start of the input, which
+     is as good a guess as any: every candidate is checked. */
+  memset (table, 0, sizeof *table << HASH_BITS);
+
+  while (end - ip >= LZ_MIN_MATCH)
+    {
+      uint32_t seq = read32 (ip);
+      size_t h = hash_seq (seq);
+      const uint8_t *ref = base + table[h];
+
+      table[h] = ip - base;
+      if (ref < ip && ip - ref <= MAX_DISTANCE && read32 (ref) == seq)
+        {
+          /* Extend the match as far as it goes.  It may overlap
+             the bytes it copies, which encodes runs. */
+          const uint8_t *mp = ip + LZ_MIN_MATCH;
+          const uint8_t *rp = ref + LZ_MIN_MATCH;
+
+          while (mp < end && *mp == *rp)
+            {
+              mp++;
+              rp++;
+            }
+          op = put_sequence (op, oend, anchor, ip - anchor, ip - ref,
+                             mp - ip);
+          if (op == NULL)
+            return 0;
+          ip = anchor = mp;
+        }
+      else
+        ip++;
+    }
+
+  op = put_sequence (op, oend, anchor, end - anchor, 0, 0);
+  return op != NULL ? (size_t) (op - (uint8_t *) dst) : 0;
+}
+
+/* Adds the continuation bytes of a count at *IP, which ends at
+   IEND, to *LEN, and advances *IP past them.  Returns false if
+   the input ends first. */
+static bool
+get_count (const uint8_t **ip, const uint8_t *iend, size_t *len)
+{
+  for (;;)
+    {
+      uint8_t b;
+
+      if (*ip >= iend)
+        return false;
+      b = *(*ip)++;
+      *len += b;
+      if (b != 255)
+        return true;
+    }
+}
+
+/* Decompresses the SRC_SIZE bytes of compressed data at SRC into
+   the DST_SIZE bytes at DST.  Returns the size of the
+   decompressed data, or 0 if SRC is not valid compressed data or
+   decompresses to more than DST_SIZE bytes.  Never reads or
+   writes outside SRC and DST, even if SRC is not valid. */
+size_t
+lz_decompress (void *dst, size_t dst_size, const void *src, size_t src_size)
+{
+  const uint8_t *ip = src;
+  const uint8_t *iend = ip + src_size;
+  uint8_t *op = dst;
+  uint8_t *oend = op + dst_size;
+
+  while (ip < iend)
+    {
+      unsigned token = *ip++;
+      size_t len = token >> 4;
+      size_t distance;
+      const uint8_t *ref;
+
+      /* Literals. */
+      if (len == TOKEN_MAX && !get_count (&ip, iend, &len))
+        return 0;
+      if ((size_t) (iend - ip) < len || (size_t) (oend - op) < len)
+        return 0;
+      memcpy (op, ip, len);
+      op += len;
+      ip += len;
+      if (ip == iend)
+        break;
+
+      /* Copy.  Byte by byte, because it may overlap itself. */
+      if (iend - ip < 2)
+        return 0;
+      distance = ip[0] | ip[1] << 8;
+      ip += 2;
+      len = token & TOKEN_MAX;
+      if (len == TOKEN_MAX && !get_count (&ip, iend, &len))
+        return 0;
+      len += LZ_MIN_MATCH;
+      if (distance == 0 || distance > (size_t) (op - (uint8_t *) dst)
+          || (size_t) (oend - op) < len)
+        return 0;
+      for (ref = op - distance; len > 0; len--)
+        *op++ = *ref++;
+    }
+  return op - (uint8_t *) dst;
+}
@@ -0,0 +1,49 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* Fast LZ77-style compression.
+
+   This is a byte-oriented compressor in the style of LZ4: it
+   finds earlier occurrences of the input's 4-byte sequences
+   through a small hash table and encodes the input as runs of
+   literal bytes, each followed by a copy of earlier output.  It
+   does no entropy coding, so it compresses less than, say,
+   deflate, but both directions run at close to memory speed,
+   which is what matters for data such as swapped-out pages that
+   stays compressed for only a short while.
+
+   Compressed data is a series of sequences, each of them
+      - a token byte, whose high 4 bits give the number of
+        literals and whose low 4 bits give the length of the
+        copy, less LZ_MIN_MATCH;
+      - if the literal count in the token is 15, more bytes of
+        count follow, each added to it, up to and including the
+        first byte that is not 255;
+      - the literal bytes;
+      - the distance back to the start of the copy, 2 bytes,
+        least significant first;
+      - if the copy length in the token is 15, more bytes of
+        length follow in the same way.
+   The last sequence ends after its literals, with no copy.
+
+   Neither function allocates memory.  lz_compress() needs a
+   caller-supplied work area of LZ_WORK_SIZE bytes, which is too
+   big to put on a kernel thread's stack. */
+
+#include <stddef.h>
+
+/* Shortest copy that is encoded as a copy. */
+#define LZ_MIN_MATCH 4
+
+/* Largest input that lz_compress() accepts. */
+#define LZ_MAX_INPUT 65536
+
+/* Size of the work area that lz_compress() needs. */
+#define LZ_WORK_SIZE 2048
+
+size_t lz_compress (void *dst, size_t dst_size,
+                    const void *src, size_t src_size, void *work);
+size_t lz_decompress (void *dst, size_t dst_size,
+                      const void *src, size_t src_size);
+
+#endif /* lib/kernel/lz.h */
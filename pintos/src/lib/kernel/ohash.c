@@ -0,0 +1,461 @@
+/* Open-addressing hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include <stdint.h>
+#include <string.h>
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Number of slots in a new table. */
+#define MIN_SLOTS 16
+
+/* Number of slots of the old array to move into the new one on
+   each insertion while the table is growing.  Growing doubles
+   the size of the table, so the old array is empty well before
+   the new one fills up. */
+#define MOVE_SLOTS 8
+
+/* Returned by find_slot() when there is no such element. */
+#define NO_SLOT ((size_t) -1)
+
+static bool alloc_table (struct ohash_table *, size_t slot_cnt);
+static size_t find_slot (struct ohash *, struct ohash_table *,
+                         unsigned hash, struct hash_elem *);
+static void insert_slot (struct ohash_table *, unsigned hash,
+                         struct hash_elem *);
+static void remove_slot (struct ohash_table *, size_t idx);
+static void move_slots (struct ohash *, size_t slot_cnt);
+static void make_room (struct ohash *);
+static struct hash_elem *find_elem (struct ohash *, unsigned hash,
+                                    struct hash_elem *);
+static struct hash_elem *delete_elem (struct ohash *, unsigned hash,
+                                      struct hash_elem *);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using LESS, given auxiliary data AUX. */
+bool
+ohash_init (struct ohash *h,
+            hash_hash_func *hash, hash_less_func *less, void *aux)
+{
+  memset (&h->old, 0, sizeof h->old);
+  h->move_idx = 0;
+  h->hash = hash;
+  h->less = less;
+  h->aux = aux;
+  return alloc_table (&h->cur, MIN_SLOTS);
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the hash.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the hash element.  However, modifying hash
+   table H while ohash_clear() is running, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(),
+   ohash_replace(), or ohash_delete(), yields undefined behavior,
+   whether done in DESTRUCTOR or elsewhere. */
+void
+ohash_clear (struct ohash *h, hash_action_func *destructor)
+{
+  if (destructor != NULL)
+    ohash_apply (h, destructor);
+
+  memset (h->cur.slots, 0, sizeof *h->cur.slots * h->cur.slot_cnt);
+  h->cur.elem_cnt = 0;
+  free (h->old.slots);
+  memset (&h->old, 0, sizeof h->old);
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash.  DESTRUCTOR may, if appropriate,
+   deallocate the memory used by the hash element.  However,
+   modifying hash table H while ohash_clear() is running, using
+   any of the functions ohash_clear(), ohash_destroy(),
+   ohash_insert(), ohash_replace(), or ohash_delete(), yields
+   undefined behavior, whether done in DESTRUCTOR or
+   elsewhere. */
+void
+ohash_destroy (struct ohash *h, hash_action_func *destructor)
+{
+  if (destructor != NULL)
+    ohash_apply (h, destructor);
+  free (h->cur.slots);
+  free (h->old.slots);
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW. */
+struct hash_elem *
+ohash_insert (struct ohash *h, struct hash_elem *new)
+{
+  unsigned hash = h->hash (new, h->aux);
+  struct hash_elem *old = find_elem (h, hash, new);
+
+  if (old == NULL)
+    {
+      make_room (h);
+      insert_slot (&h->cur, hash, new);
+    }
+  return old;
+}
+
+/* Inserts NEW into hash table H, replacing any equal element
+   already in the table, which is returned. */
+struct hash_elem *
+ohash_replace (struct ohash *h, struct hash_elem *new)
+{
+  unsigned hash = h->hash (new, h->aux);
+  struct hash_elem *old = delete_elem (h, hash, new);
+
+  make_room (h);
+  insert_slot (&h->cur, hash, new);
+  return old;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table. */
+struct hash_elem *
+ohash_find (struct ohash *h, struct hash_elem *e)
+{
+  return find_elem (h, h->hash (e, h->aux), e);
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct hash_elem *
+ohash_delete (struct ohash *h, struct hash_elem *e)
+{
+  return delete_elem (h, h->hash (e, h->aux), e);
+}
+
+/* Calls ACTION for each element in hash table H in arbitrary
+   order.
+   Modifying hash table H while ohash_apply() is running, using
+   any of the functions ohash_clear(), ohash_destroy(),
+   ohash_insert(), ohash_replace(), or ohash_delete(), yields
+   undefined behavior, whether done from ACTION or elsewhere. */
+void
+ohash_apply (struct ohash *h, hash_action_func *action)
+{
+  struct ohash_iterator i;
+
+  ASSERT (action != NULL);
+
+  ohash_first (&i, h);
+  while (ohash_next (&i))
+    action (ohash_cur (&i), h->aux);
+}
+
+/* Initializes I for iterating hash table H.
+
+   Iteration idiom:
+
+      struct ohash_iterator i;
+
+      ohash_first (&i, h);
+      while (ohash_next (&i))
+        {
+          struct foo *f = hash_entry (ohash_cur (&i), struct foo, elem);
+          ...do something with f...
+        }
+
+   Modifying hash table H during iteration, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(),
+   ohash_replace(), or ohash_delete(), invalidates all
+   iterators. */
+void
+ohash_first (struct ohash_iterator *i, struct ohash *h)
+{
+  ASSERT (i != NULL);
+  ASSERT (h != NULL);
+
+  i->hash = h;
+  i->table = &h->cur;
+  i->idx = (size_t) -1;
+  i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order.
+
+   Modifying a hash table H during iteration, using any of the
+   functions ohash_clear(), ohash_destroy(), ohash_insert(),
+   ohash_replace(), or ohash_delete(), invalidates all
+   iterators. */
+struct hash_elem *
+ohash_next (struct ohash_iterator *i)
+{
+  ASSERT (i != NULL);
+
+  for (;;)
+    {
+      if (++i->idx < i->table->slot_cnt)
+        {
+          i->elem = i->table->slots[i->idx].elem;
+          if (i->elem != NULL)
+            break;
+        }
+      else if (i->table == &i->hash->cur)
+        {
+          i->table = &i->hash->old;
+          i->idx = (size_t) -1;
+        }
+      else
+        {
+          i->elem = NULL;
+          break;
+        }
+    }
+  return i->elem;
+}
+
+/* Returns the current element in the hash table iteration, or a
+   null pointer at the end of the table.  Undefined behavior
+   after calling ohash_first() but before ohash_next(). */
+struct hash_elem *
+ohash_cur (struct ohash_iterator *i)
+{
+  return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (struct ohash *h)
+{
+  return h->cur.elem_cnt + h->old.elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+ohash_empty (struct ohash *h)
+{
+  return ohash_size (h) == 0;
+}
+
+/* Makes T an empty array of SLOT_CNT slots, which must be a
+   power of 2.  Returns true if successful, false if memory is
+   not available. */
+static bool
+alloc_table (struct ohash_table *t, size_t slot_cnt)
+{
+  t->slots = calloc (slot_cnt, sizeof *t->slots);
+  t->slot_cnt = t->slots != NULL ? slot_cnt : 0;
+  t->elem_cnt = 0;
+  return t->slots != NULL;
+}
+
+/* Returns how far slot IDX in T is from the home slot of an
+   element with hash value HASH. */
+static inline size_t
+probe_distance (const struct ohash_table *t, unsigned hash, size_t idx)
+{
+  return (idx - hash) & (t->slot_cnt - 1);
+}
+
+/* Searches T, in H, for an element equal to E, whose hash value
+   is HASH.  Returns its slot if found, otherwise NO_SLOT. */
+static size_t
+find_slot (struct ohash *h, struct ohash_table *t, unsigned hash,
+           struct hash_elem *e)
+{
+  size_t mask = t->slot_cnt - 1;
+  size_t idx, dist;
+
+  if (t->elem_cnt == 0)
+    return NO_SLOT;
+
+  /* Robin Hood insertion never leaves an element further from
+     its home slot than an element that follows it, so once we
+     see a free slot or one whose element is closer to home than
+     we have come, E is not in T. */
+  for (idx = hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++)
+    {
+      struct ohash_slot *s = &t->slots[idx];
+
+      if (s->elem == NULL || probe_distance (t, s->hash, idx) < dist)
+        return NO_SLOT;
+      if (s->hash == hash
+          && !h->less (s->elem, e, h->aux) && !h->less (e, s->elem, h->aux))
+        return idx;
+    }
+}
+
+/* Inserts E, whose hash value is HASH, into T, which must have
+   a free slot and must not already contain E. */
+static void
+insert_slot (struct ohash_table *t, unsigned hash, struct hash_elem *e)
+{
+  size_t mask = t->slot_cnt - 1;
+  size_t idx, dist;
+
+  ASSERT (t->elem_cnt < t->slot_cnt);
+
+  t->elem_cnt++;
+  for (idx = hash & mask, dist = 0; ; idx = (idx + 1) & mask, dist++)
+    {
+      struct ohash_slot *s = &t->slots[idx];
+      size_t s_dist;
+
+      if (s->elem == NULL)
+        {
+          s->hash = hash;
+          s->elem = e;
+          return;
+        }
+
+      /* Take the slot from an element closer to its home slot,
+         and go on to find a place for that element instead. */
+      s_dist = probe_distance (t, s->hash, idx);
+      if (s_dist < dist)
+        {
+          struct ohash_slot displaced = *s;
+          s->hash = hash;
+          s->elem = e;
+          hash = displaced.hash;
+          e = displaced.elem;
+          dist = s_dist;
+        }
+    }
+}
+
+/* Removes the element in slot IDX of T. */
+static void
+remove_slot (struct ohash_table *t, size_t idx)
+{
+  size_t mask = t->slot_cnt - 1;
+
+  /* Shift back each following element that is not in its home
+     slot, up to the next free slot. */
+  t->elem_cnt--;
+  for (;;)
+    {
+      size_t next = (idx + 1) & mask;
+      struct ohash_slot *s = &t->slots[next];
+
+      if (s->elem == NULL || probe_distance (t, s->hash, next) == 0)
+        {
+          t->slots[idx].elem = NULL;
+          return;
+        }
+      t->slots[idx] = *s;
+      idx = next;
+    }
+}
+
+/* Moves the elements in up to SLOT_CNT slots of H's old array
+   into its current array, freeing the old array once it is
+   empty.
+
+   Slots move in order, so every slot before MOVE_IDX is free.
+   Removing an element only shifts later elements back, into
+   slots at or after MOVE_IDX, and none are added to the old
+   array, so that stays true, and the old array remains valid
+   for lookups until it is empty. */
+static void
+move_slots (struct ohash *h, size_t slot_cnt)
+{
+  struct ohash_table *old = &h->old;
+
+  while (old->elem_cnt > 0 && slot_cnt-- > 0)
+    {
+      struct ohash_slot *s = &old->slots[h->move_idx];
+
+      if (s->elem != NULL)
+        {
+          unsigned hash = s->hash;
+          struct hash_elem *e = s->elem;
+
+          remove_slot (old, h->move_idx);
+          insert_slot (&h->cur, hash, e);
+        }
+      else
+        h->move_idx++;
+    }
+
+  if (old->slots != NULL && old->elem_cnt == 0)
+    {
+      free (old->slots);
+      memset (old, 0, sizeof *old);
+    }
+}
+
+/* Makes sure that H has room to insert an element into its
+   current array, growing the table if it is getting full. */
+static void
+make_room (struct ohash *h)
+{
+  struct ohash_table new;
+
+  move_slots (h, MOVE_SLOTS);
+  if ((ohash_size (h) + 1) * 8 <= h->cur.slot_cnt * 7)
+    return;
+
+  /* Finish moving the previous array, if we somehow have not
+     already, and start moving the current one. */
+  move_slots (h, SIZE_MAX);
+  if (alloc_table (&new, h->cur.slot_cnt * 2))
+    {
+      h->old = h->cur;
+      h->cur = new;
+      h->move_idx = 0;
+    }
+  else if (h->cur.elem_cnt + 1 >= h->cur.slot_cnt)
+    {
+      /* We can go on using a table that is nearly full, if more
+         slowly, but not one that is completely full. */
+      PANIC ("ohash: out of memory growing table to %zu slots",
+             h->cur.slot_cnt * 2);
+    }
+}
+
+/* Finds and returns an element equal to E, whose hash value is
+   HASH, in H.  Returns a null pointer if there is none. */
+static struct hash_elem *
+find_elem (struct ohash *h, unsigned hash, struct hash_elem *e)
+{
+  size_t idx;
+
+  idx = find_slot (h, &h->cur, hash, e);
+  if (idx != NO_SLOT)
+    return h->cur.slots[idx].elem;
+  idx = find_slot (h, &h->old, hash, e);
+  if (idx != NO_SLOT)
+    return h->old.slots[idx].elem;
+  return NULL;
+}
+
+/* Finds, removes, and returns an element equal to E, whose hash
+   value is HASH, in H.  Returns a null pointer if there is
+   none. */
+static struct hash_elem *
+delete_elem (struct ohash *h, unsigned hash, struct hash_elem *e)
+{
+  struct ohash_table *tables[2] = {&h->cur, &h->old};
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      size_t idx = find_slot (h, tables[i], hash, e);
+      if (idx != NO_SLOT)
+        {
+          struct hash_elem *found = tables[i]->slots[idx].elem;
+          remove_slot (tables[i], idx);
+          if (tables[i] == &h->old)
+            move_slots (h, 0);
+          return found;
+        }
+    }
+  return NULL;
+}
@@ -0,0 +1,96 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressing hash table.
+
+   A drop-in alternative to the chained table in hash.h, for
+   tables big enough that chasing list pointers from bucket to
+   bucket dominates the cost of a lookup.  Elements embed the
+   same struct hash_elem, are converted back with the same
+   hash_entry() macro, and are hashed and compared with the same
+   hash_hash_func and hash_less_func, so a table can be switched
+   from one implementation to the other by renaming the calls.
+
+   The table itself is an array of slots, each holding an
+   element pointer and the element's hash value.  An element
+   goes in the first free slot at or after the one its hash
+   selects, using "Robin Hood" linear probing: an element that
+   is further from its home slot takes the place of one that is
+   closer, which keeps probe sequences short and lets a lookup
+   stop as soon as it passes the place where the element would
+   have to be.  The stored hash values mean that the comparison
+   function is called, in practice, only for the element that
+   matches.  Deletion shifts the following elements back by one
+   slot instead of leaving a "tombstone", so lookups never slow
+   down as elements come and go.
+
+   When the table gets 7/8 full, it doubles in size.  Instead of
+   moving every element at once, which would make one unlucky
+   insertion take time proportional to the size of the table,
+   the old array is kept and a few of its slots are moved to the
+   new array on each later insertion.  Lookups check both arrays
+   until the old one is empty.  The table never shrinks, except
+   that ohash_clear() empties it. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "hash.h"
+
+/* A slot in an array of slots. */
+struct ohash_slot
+  {
+    unsigned hash;              /* Hash value of ELEM. */
+    struct hash_elem *elem;     /* Element, or null if slot is free. */
+  };
+
+/* An array of slots. */
+struct ohash_table
+  {
+    struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+    size_t slot_cnt;            /* Number of slots, a power of 2, or 0. */
+    size_t elem_cnt;            /* Number of elements in SLOTS. */
+  };
+
+/* Open-addressing hash table. */
+struct ohash
+  {
+    struct ohash_table cur;     /* Array that takes new elements. */
+    struct ohash_table old;     /* Array being moved into CUR, if any. */
+    size_t move_idx;            /* Next slot in OLD to move. */
+    hash_hash_func *hash;       /* Hash function. */
+    hash_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `hash' and `less'. */
+  };
+
+/* An open-addressing hash table iterator. */
+struct ohash_iterator
+  {
+    struct ohash *hash;         /* The hash table. */
+    struct ohash_table *table;  /* Current array of slots. */
+    size_t idx;                 /* Current slot in TABLE. */
+    struct hash_elem *elem;     /* Current hash element. */
+  };
+
+/* Basic life cycle. */
+bool ohash_init (struct ohash *, hash_hash_func *, hash_less_func *,
+                 void *aux);
+void ohash_clear (struct ohash *, hash_action_func *);
+void ohash_destroy (struct ohash *, hash_action_func *);
+
+/* Search, insertion, deletion. */
+struct hash_elem *ohash_insert (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_replace (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_find (struct ohash *, struct hash_elem *);
+struct hash_elem *ohash_delete (struct ohash *, struct hash_elem *);
+
+/* Iteration. */
+void ohash_apply (struct ohash *, hash_action_func *);
+void ohash_first (struct ohash_iterator *, struct ohash *);
+struct hash_elem *ohash_next (struct ohash_iterator *);
+struct hash_elem *ohash_cur (struct ohash_iterator *);
+
+/* Information. */
+size_t ohash_size (struct ohash *);
+bool ohash_empty (struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
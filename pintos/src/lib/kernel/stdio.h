@@ -1,6 +1,9 @@
 #ifndef __LIB_KERNEL_STDIO_H
 #define __LIB_KERNEL_STDIO_H
 
+#include <iovec.h>
+
 void putbuf (const char *, size_t);
+void putbufv (const struct iovec *, size_t cnt);
 
 #endif /* lib/kernel/stdio.h */
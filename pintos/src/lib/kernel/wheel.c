@@ -0,0 +1,147 @@
+/* Hierarchical timing wheel.
+
+   See wheel.h for basic information. */
+
+#include "wheel.h"
+#include "../debug.h"
+
+/* Mask for the slot number within a level. */
+#define SLOT_MASK (WHEEL_SLOTS - 1)
+
+static void place (struct wheel *, struct wheel_elem *, int64_t tick);
+static void cascade (struct wheel *, int level);
+
+/* Initializes W as an empty wheel whose current tick is NOW. */
+void
+wheel_init (struct wheel *w, int64_t now)
+{
+  int level, slot;
+
+  w->now = now;
+  w->elem_cnt = 0;
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SLOTS; slot++)
+      list_init (&w->slots[level][slot]);
+}
+
+/* Adds timer E to W, to fire when W's clock reaches tick
+   EXPIRES.  A timer for a tick that has already come fires on
+   the next call to wheel_advance() that moves the clock.  E
+   must not already be in a wheel. */
+void
+wheel_add (struct wheel *w, struct wheel_elem *e, int64_t expires)
+{
+  e->expires = expires;
+  place (w, e, expires > w->now ? expires : w->now + 1);
+  w->elem_cnt++;
+}
+
+/* Removes timer E, which must be pending in W, from W, so that
+   it will not fire. */
+void
+wheel_cancel (struct wheel *w, struct wheel_elem *e)
+{
+  ASSERT (w->elem_cnt > 0);
+
+  list_remove (&e->list_elem);
+  w->elem_cnt--;
+}
+
+/* Advances W's clock to tick NOW, calling FIRE, with auxiliary
+   data AUX, for each timer that comes due, in order of the ticks
+   at which they were due.  FIRE may add and cancel timers. */
+void
+wheel_advance (struct wheel *w, int64_t now, wheel_fire_func *fire,
+               void *aux)
+{
+  ASSERT (fire != NULL);
+
+  while (w->now < now)
+    {
+      struct list *slot;
+      int level;
+
+      /* With no timers pending, there is nothing to move or
+         fire, however far the clock goes. */
+      if (w->elem_cnt == 0)
+        {
+          w->now = now;
+          break;
+        }
+
+      /* At the start of each higher-level slot, move its timers
+         down. */
+      w->now++;
+      for (level = 1; level < WHEEL_LEVELS; level++)
+        {
+          if ((w->now >> (WHEEL_BITS * (level - 1))) & SLOT_MASK)
+            break;
+          cascade (w, level);
+        }
+
+      /* Fire the timers due now. */
+      slot = &w->slots[0][w->now & SLOT_MASK];
+      while (!list_empty (slot))
+        {
+          struct wheel_elem *e = list_entry (list_pop_front (slot),
+                                             struct wheel_elem, list_elem);
+          w->elem_cnt--;
+          fire (e, aux);
+        }
+    }
+}
+
+/* Returns the number of timers pending in W. */
+size_t
+wheel_size (struct wheel *w)
+{
+  return w->elem_cnt;
+}
+
+/* Returns true if W has no timers pending, false otherwise. */
+bool
+wheel_empty (struct wheel *w)
+{
+  return w->elem_cnt == 0;
+}
+
+/* Puts timer E in the slot of W where it will wait for TICK,
+   which must not be before W's current tick. */
+static void
+place (struct wheel *w, struct wheel_elem *e, int64_t tick)
+{
+  int64_t delta = tick - w->now;
+  int level;
+
+  ASSERT (delta >= 0);
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+      break;
+
+  /* A timer too far ahead for the top level waits in the last
+     slot it reaches, and is placed again when that slot
+     cascades. */
+  if (delta >= (int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+    tick = w->now + ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+
+  list_push_back (&w->slots[level][(tick >> (WHEEL_BITS * level))
+                                   & SLOT_MASK],
+                  &e->list_elem);
+}
+
+/* Moves the timers in W's current slot at LEVEL into the levels
+   below it. */
+static void
+cascade (struct wheel *w, int level)
+{
+  struct list *slot = &w->slots[level][(w->now >> (WHEEL_BITS * level))
+                                       & SLOT_MASK];
+
+  while (!list_empty (slot))
+    {
+      struct wheel_elem *e = list_entry (list_pop_front (slot),
+                                         struct wheel_elem, list_elem);
+      place (w, e, e->expires > w->now ? e->expires : w->now);
+    }
+}
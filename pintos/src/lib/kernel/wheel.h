@@ -0,0 +1,85 @@
+#ifndef __LIB_KERNEL_WHEEL_H
+#define __LIB_KERNEL_WHEEL_H
+
+/* Hierarchical timing wheel.
+
+   A timing wheel keeps a set of timers, each due at some tick,
+   and fires each one when the clock passes its tick.  Adding
+   and cancelling a timer are O(1), and advancing the clock by a
+   tick costs O(1) plus the timers that fire, which makes a
+   wheel a better fit than a sorted list for something like a
+   sleep queue that gets a new entry, and is checked, on every
+   timer tick.
+
+   The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots, each
+   slot a list of timers.  A timer due within WHEEL_SLOTS ticks
+   goes in the level 0 slot for its tick.  One due later goes in
+   a slot of a higher level, each of which covers WHEEL_SLOTS
+   times as many ticks per slot as the level below.  Whenever
+   the clock reaches the start of a higher-level slot, that
+   slot's timers are "cascaded" into the levels below, so that
+   every timer reaches level 0 before it is due.  A timer due
+   further ahead than the top level reaches waits in its last
+   slot and cascades as often as needed.
+
+   Like a list, a wheel does not allocate its timers.  Each
+   structure that can be a timer embeds a struct wheel_elem
+   member, and wheel_entry() converts a struct wheel_elem back to
+   the structure that contains it, just as list_entry() does for
+   lists (see list.h).
+
+   A wheel does no locking.  A wheel advanced from the timer
+   interrupt handler, for example, must be used with interrupts
+   off. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "list.h"
+
+/* Slots per level, and number of levels.  Level L covers ticks
+   up to WHEEL_SLOTS ** (L + 1) ahead, so 4 levels of 64 slots
+   reach 16,777,216 ticks ahead, which at 100 ticks per second
+   is almost two days. */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+/* Timer. */
+struct wheel_elem
+  {
+    struct list_elem list_elem; /* Element in a slot's list. */
+    int64_t expires;            /* Tick at which to fire. */
+  };
+
+/* Converts pointer to wheel element WHEEL_ELEM into a pointer
+   to the structure that WHEEL_ELEM is embedded inside.  Supply
+   the name of the outer structure STRUCT and the member name
+   MEMBER of the wheel element. */
+#define wheel_entry(WHEEL_ELEM, STRUCT, MEMBER)                 \
+        ((STRUCT *) ((uint8_t *) &(WHEEL_ELEM)->list_elem       \
+                     - offsetof (STRUCT, MEMBER.list_elem)))
+
+/* Called for timer E when it fires, given auxiliary data AUX.
+   E has already been removed from the wheel, so the function
+   may add it again or free it. */
+typedef void wheel_fire_func (struct wheel_elem *e, void *aux);
+
+/* Timing wheel. */
+struct wheel
+  {
+    int64_t now;                /* Current tick. */
+    size_t elem_cnt;            /* Number of timers pending. */
+    struct list slots[WHEEL_LEVELS][WHEEL_SLOTS];
+  };
+
+void wheel_init (struct wheel *, int64_t now);
+void wheel_add (struct wheel *, struct wheel_elem *, int64_t expires);
+void wheel_cancel (struct wheel *, struct wheel_elem *);
+void wheel_advance (struct wheel *, int64_t now, wheel_fire_func *,
+                    void *aux);
+
+size_t wheel_size (struct wheel *);
+bool wheel_empty (struct wheel *);
+
+#endif /* lib/kernel/wheel.h */
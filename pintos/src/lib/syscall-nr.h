@@ -28,7 +28,25 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_PIPE,                   /* Create an anonymous pipe. */
+    SYS_SBRK,                   /* Grow or shrink the heap. */
+    SYS_FUTEX_WAIT,             /* Sleep while a futex holds a value. */
+    SYS_FUTEX_WAKE,             /* Wake threads sleeping on a futex. */
+    SYS_THREAD_CREATE,          /* Start a thread in this process. */
+    SYS_THREAD_JOIN,            /* Wait for a thread to exit. */
+    SYS_COPY_FILE_RANGE,        /* Copy data from one file to another. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
+    SYS_FSYNC,                  /* Commit file system changes to disk. */
+    SYS_IO_SETUP,               /* Register an asynchronous I/O ring. */
+    SYS_IO_SUBMIT,              /* Start asynchronous I/O requests. */
+    SYS_IO_WAIT,                /* Wait for asynchronous I/O to complete. */
+    SYS_GETSTATS,               /* Report a thread's accounting. */
+
+    SYS_CNT                     /* Number of system calls. */
   };
 
 #endif /* lib/syscall-nr.h */
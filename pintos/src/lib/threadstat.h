@@ -0,0 +1,26 @@
+#ifndef __LIB_THREADSTAT_H
+#define __LIB_THREADSTAT_H
+
+#include <stdint.h>
+#include <syscall-nr.h>
+
+/* Accounting for one thread, as reported by getstats().  All the
+   counts start from 0 when the thread is created. */
+struct thread_stat
+  {
+    int tid;                    /* Thread identifier. */
+    char name[16];              /* Thread name. */
+    char state;                 /* 'R' running, 'W' waiting to run,
+                                   'B' blocked, or 'D' dying: exited
+                                   but not yet freed. */
+    int64_t ticks;              /* Timer ticks spent running. */
+    unsigned voluntary_switches;   /* Times it blocked. */
+    unsigned involuntary_switches; /* Times it was preempted or
+                                      yielded. */
+    unsigned page_faults;       /* Page faults taken. */
+    uint64_t read_bytes;        /* Bytes read by system calls. */
+    uint64_t write_bytes;       /* Bytes written by system calls. */
+    unsigned syscalls[SYS_CNT]; /* System calls made, by number. */
+  };
+
+#endif /* lib/threadstat.h */
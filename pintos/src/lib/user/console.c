@@ -1,8 +1,84 @@
 #include <stdio.h>
 #include <string.h>
+#include <synch.h>
 #include <syscall.h>
 #include <syscall-nr.h>
 
+/* Standard output buffer.  While buffering is on, output to
+   STDOUT_FILENO collects here and goes to the kernel in writes
+   of up to sizeof stdout_buf bytes, when the buffer fills, when
+   stdout_flush() is called, and before the process exits, halts,
+   or runs or waits for another process.  Output is lost if the
+   process is killed, so buffering is off unless the program
+   turns it on. */
+static char stdout_buf[4096];
+static size_t stdout_len;
+static bool stdout_buffered;
+static struct lock stdout_lock;
+
+static void output (int handle, const char *, size_t);
+
+/* Turns buffering of standard output on or off. */
+void
+stdout_set_buffered (bool buffered)
+{
+  if (!buffered)
+    stdout_flush ();
+  stdout_buffered = buffered;
+}
+
+/* Writes out anything in the standard output buffer. */
+void
+stdout_flush (void)
+{
+  lock_acquire (&stdout_lock);
+  if (stdout_len > 0)
+    {
+      write (STDOUT_FILENO, stdout_buf, stdout_len);
+      stdout_len = 0;
+    }
+  lock_release (&stdout_lock);
+}
+
+/* Writes the N bytes in BUFFER to HANDLE, through the standard
+   output buffer if HANDLE is standard output and buffering is
+   on. */
+static void
+output (int handle, const char *buffer, size_t n)
+{
+  if (handle != STDOUT_FILENO || !stdout_buffered)
+    {
+      write (handle, buffer, n);
+      return;
+    }
+
+  lock_acquire (&stdout_lock);
+  if (stdout_len + n <= sizeof stdout_buf)
+    {
+      memcpy (stdout_buf + stdout_len, buffer, n);
+      stdout_len += n;
+    }
+  else if (n < sizeof stdout_buf)
+    {
+      write (STDOUT_FILENO, stdout_buf, stdout_len);
+      memcpy (stdout_buf, buffer, n);
+      stdout_len = n;
+    }
+  else
+    {
+      /* Too big to buffer: send it along with what we have. */
+      struct iovec iov[2];
+
+      iov[0].iov_base = stdout_buf;
+      iov[0].iov_len = stdout_len;
+      iov[1].iov_base = (char *) buffer;
+      iov[1].iov_len = n;
+      writev (STDOUT_FILENO, iov, 2);
+      stdout_len = 0;
+    }
+  lock_release (&stdout_lock);
+}
+
 /* The standard vprintf() function,
    which is like printf() but uses a va_list. */
 int
@@ -30,8 +106,22 @@ hprintf (int handle, const char *format, ...)
 int
 puts (const char *s) 
 {
-  write (STDOUT_FILENO, s, strlen (s));
-  putchar ('\n');
+  if (stdout_buffered)
+    {
+      output (STDOUT_FILENO, s, strlen (s));
+      output (STDOUT_FILENO, "\n", 1);
+    }
+  else
+    {
+      /* Write the line in one piece. */
+      struct iovec iov[2];
+
+      iov[0].iov_base = (char *) s;
+      iov[0].iov_len = strlen (s);
+      iov[1].iov_base = "\n";
+      iov[1].iov_len = 1;
+      writev (STDOUT_FILENO, iov, 2);
+    }
 
   return 0;
 }
@@ -41,7 +131,7 @@ int
 putchar (int c) 
 {
   char c2 = c;
-  write (STDOUT_FILENO, &c2, 1);
+  output (STDOUT_FILENO, &c2, 1);
   return c;
 }
 
@@ -89,6 +179,6 @@ static void
 flush (struct vhprintf_aux *aux)
 {
   if (aux->p > aux->buf)
-    write (aux->handle, aux->buf, aux->p - aux->buf);
+    output (aux->handle, aux->buf, aux->p - aux->buf);
   aux->p = aux->buf;
 }
@@ -0,0 +1,446 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <synch.h>
+#include <syscall.h>
+
+/* A malloc() for user programs, on top of the sbrk() system
+   call.
+
+   Small requests, up to 1 kB with the block header, are rounded
+   up to a power of 2 and served from a free list for that size
+   class.  If the free list is empty, a block is carved off the
+   current "arena", a 64 kB chunk of the heap, by bumping a
+   pointer.  Freed small blocks go back on their class's free
+   list and are never merged or returned to the heap, so the
+   common case, in both directions, is a handful of instructions.
+
+   Larger requests, and the arenas themselves, are "large
+   blocks", which lie end to end across the heap.  Each one's
+   header records its own size and the size of the block before
+   it, so that a freed large block can be merged with free
+   neighbors on both sides.  Free large blocks are kept on a
+   single list, searched first-fit; a free block bigger than the
+   request is split.  If nothing fits, the heap grows with
+   sbrk(), and when a free block at the top of the heap gets big
+   enough, the heap shrinks again.
+
+   One lock serializes all of the above among a process's
+   threads.  Programs that use malloc() must not move the break
+   with sbrk() themselves. */
+
+/* Header at the start of every block.  Payloads follow it and
+   are aligned on 8-byte boundaries. */
+struct header
+  {
+    size_t prev_size;           /* Size of preceding large block, or 0. */
+    size_t size;                /* Block size, including header, | flags. */
+  };
+
+/* Flags in a header's size. */
+#define IN_USE 1                /* Block is allocated. */
+#define SMALL 2                 /* Small block (in an arena). */
+#define SIZE_MASK (~(size_t) 7) /* Bits of the size itself. */
+
+/* A free small block. */
+struct small_block
+  {
+    struct header header;
+    struct small_block *next;   /* Next block in free list. */
+  };
+
+/* A free large block. */
+struct large_block
+  {
+    struct header header;
+    struct large_block *prev;   /* Previous block in free list. */
+    struct large_block *next;   /* Next block in free list. */
+  };
+
+/* Size classes of small blocks: 16, 32, ..., 1024 bytes. */
+#define MIN_SMALL 16
+#define MAX_SMALL 1024
+#define CLASS_CNT 7
+
+/* Size of an arena. */
+#define ARENA_SIZE (64 * 1024)
+
+/* Least amount by which we grow the heap at a time, and how big
+   a free block at the top of the heap must be before we give
+   memory back. */
+#define GROW_MIN (64 * 1024)
+#define TRIM_MIN (128 * 1024)
+
+/* Smallest large block worth splitting off. */
+#define MIN_LARGE 64
+
+/* Free lists of small blocks, one per size class. */
+static struct small_block *small_free[CLASS_CNT];
+
+/* Unused part of the current arena. */
+static uint8_t *bump, *bump_end;
+
+/* Extent of the heap and its last large block. */
+static uint8_t *heap_start, *heap_end;
+static struct header *last_block;
+
+/* Free list of large blocks. */
+static struct large_block large_free = {{0, 0}, &large_free, &large_free};
+
+/* Protects all of the above.  A zeroed lock is free. */
+static struct lock malloc_lock;
+
+static void *large_alloc (size_t size);
+static void large_free_block (struct header *);
+static void set_large_size (struct header *, size_t size, size_t flags);
+static bool grow_heap (size_t size);
+static void *do_malloc (size_t size);
+static void do_free (void *p);
+
+/* Returns the size of the block that H heads. */
+static inline size_t
+block_size (const struct header *h)
+{
+  return h->size & SIZE_MASK;
+}
+
+/* Returns the block after H in the heap, or a null pointer if H
+   is the last. */
+static inline struct header *
+next_block (struct header *h)
+{
+  return h != last_block ? (void *) ((uint8_t *) h + block_size (h)) : NULL;
+}
+
+/* Returns the block before H in the heap, or a null pointer if H
+   is the first. */
+static inline struct header *
+prev_block (struct header *h)
+{
+  return h->prev_size != 0 ? (void *) ((uint8_t *) h - h->prev_size) : NULL;
+}
+
+/* Returns the size class for a block of SIZE bytes, which must
+   be at most MAX_SMALL. */
+static inline int
+size_class (size_t size)
+{
+  return size <= MIN_SMALL ? 0 : 32 - __builtin_clz (size - 1) - 4;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size)
+{
+  void *p;
+
+  lock_acquire (&malloc_lock);
+  p = do_malloc (size);
+  lock_release (&malloc_lock);
+  return p;
+}
+
+/* Does the work of malloc(). */
+static void *
+do_malloc (size_t size)
+{
+  struct header *h;
+
+  if (size == 0 || size > SIZE_MAX / 2)
+    return NULL;
+  size = ROUND_UP (size + sizeof *h, 8);
+
+  if (size <= MAX_SMALL)
+    {
+      int class = size_class (size);
+      struct small_block *b = small_free[class];
+
+      /* Fast path: reuse a free block. */
+      if (b != NULL)
+        {
+          small_free[class] = b->next;
+          b->header.size |= IN_USE;
+          return &b->header + 1;
+        }
+
+      /* Carve a block off the current arena, starting a new one
+         if necessary. */
+      size = MIN_SMALL << class;
+      if ((size_t) (bump_end - bump) < size)
+        {
+          struct header *arena = large_alloc (ARENA_SIZE);
+          if (arena == NULL)
+            return NULL;
+          bump = (uint8_t *) (arena + 1);
+          bump_end = (uint8_t *) arena + block_size (arena);
+        }
+      h = (struct header *) bump;
+      bump += size;
+      h->size = size | SMALL | IN_USE;
+    }
+  else
+    {
+      h = large_alloc (size);
+      if (h == NULL)
+        return NULL;
+    }
+  return h + 1;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+  size_t size;
+
+  /* Calculate block size and make sure it fits in size_t. */
+  size = a * b;
+  if (size < a || size < b)
+    return NULL;
+
+  /* Allocate and zero memory. */
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+
+  return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(new_size).
+   A call with zero NEW_SIZE is equivalent to free(old_block). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  struct header *h;
+  size_t old_size;
+  void *new_block;
+
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  if (old_block == NULL)
+    return malloc (new_size);
+
+  h = (struct header *) old_block - 1;
+  old_size = block_size (h) - sizeof *h;
+  if (new_size <= old_size)
+    return old_block;
+
+  new_block = malloc (new_size);
+  if (new_block != NULL)
+    {
+      memcpy (new_block, old_block, old_size);
+      free (old_block);
+    }
+  return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  if (p != NULL)
+    {
+      lock_acquire (&malloc_lock);
+      do_free (p);
+      lock_release (&malloc_lock);
+    }
+}
+
+/* Does the work of free() for non-null P. */
+static void
+do_free (void *p)
+{
+  struct header *h = (struct header *) p - 1;
+
+  ASSERT (h->size & IN_USE);
+  if (h->size & SMALL)
+    {
+      struct small_block *b = (struct small_block *) h;
+      int class = size_class (block_size (h));
+
+      h->size &= ~IN_USE;
+      b->next = small_free[class];
+      small_free[class] = b;
+    }
+  else
+    {
+      large_free_block (h);
+
+      /* Shrink the heap if its top is mostly free. */
+      h = last_block;
+      if (!(h->size & IN_USE) && block_size (h) >= TRIM_MIN)
+        {
+          size_t trim = (block_size (h) - GROW_MIN) & ~(size_t) 4095;
+          if (sbrk (-(intptr_t) trim) != (void *) -1)
+            {
+              heap_end -= trim;
+              set_large_size (h, block_size (h) - trim, 0);
+            }
+        }
+    }
+}
+
+/* Removes B from the free list of large blocks. */
+static void
+unlink_large (struct large_block *b)
+{
+  b->prev->next = b->next;
+  b->next->prev = b->prev;
+}
+
+/* Sets the size of large block H to SIZE, with flags FLAGS, and
+   updates the block after it to match. */
+static void
+set_large_size (struct header *h, size_t size, size_t flags)
+{
+  struct header *next;
+
+  h->size = size | flags;
+  next = next_block (h);
+  if (next != NULL)
+    next->prev_size = size;
+}
+
+/* Finds or makes room for a large block of SIZE bytes, which
+   must be a multiple of 8, marks it in use, and returns its
+   header.  Returns a null pointer if the heap can't grow. */
+static void *
+large_alloc (size_t size)
+{
+  struct large_block *b;
+  struct header *h;
+  size_t have;
+
+  if (size < sizeof *b)
+    size = sizeof *b;
+
+  /* First fit, or grow the heap and retry. */
+  for (b = large_free.next; b != &large_free; b = b->next)
+    if (block_size (&b->header) >= size)
+      break;
+  if (b == &large_free)
+    {
+      if (!grow_heap (size))
+        return NULL;
+      b = large_free.next;
+      ASSERT (block_size (&b->header) >= size);
+    }
+  unlink_large (b);
+  h = &b->header;
+
+  /* Split off the part we don't need, if it's big enough to be
+     worth keeping. */
+  have = block_size (h);
+  if (have - size >= MIN_LARGE)
+    {
+      struct header *rest = (struct header *) ((uint8_t *) h + size);
+
+      rest->prev_size = size;
+      rest->size = IN_USE;
+      if (last_block == h)
+        last_block = rest;
+      set_large_size (rest, have - size, IN_USE);
+      set_large_size (h, size, IN_USE);
+      large_free_block (rest);
+    }
+  else
+    h->size |= IN_USE;
+  return h;
+}
+
+/* Frees large block H, merging it with free neighbors. */
+static void
+large_free_block (struct header *h)
+{
+  struct header *next = next_block (h);
+  struct header *prev = prev_block (h);
+  struct large_block *b;
+  size_t size = block_size (h);
+
+  if (next != NULL && !(next->size & IN_USE))
+    {
+      unlink_large ((struct large_block *) next);
+      size += block_size (next);
+      if (last_block == next)
+        last_block = h;
+    }
+  if (prev != NULL && !(prev->size & IN_USE))
+    {
+      unlink_large ((struct large_block *) prev);
+      size += block_size (prev);
+      if (last_block == h)
+        last_block = prev;
+      h = prev;
+    }
+  set_large_size (h, size, 0);
+
+  b = (struct large_block *) h;
+  b->next = large_free.next;
+  b->prev = &large_free;
+  large_free.next->prev = b;
+  large_free.next = b;
+}
+
+/* Grows the heap so that there is a free large block of at
+   least SIZE bytes, and puts it at the front of the free list.
+   Returns true if successful, false if the kernel refused. */
+static bool
+grow_heap (size_t size)
+{
+  struct header *top = last_block;
+  size_t need = size;
+  size_t incr;
+  uint8_t *p;
+
+  /* If the last block is free, we only need to extend it. */
+  if (top != NULL && !(top->size & IN_USE))
+    need -= block_size (top);
+
+  incr = ROUND_UP (need, GROW_MIN);
+  p = sbrk (incr);
+  if (p == (void *) -1)
+    {
+      incr = ROUND_UP (need, 4096);
+      p = sbrk (incr);
+      if (p == (void *) -1)
+        return false;
+    }
+  if (heap_start == NULL)
+    heap_start = heap_end = p;
+  ASSERT (p == heap_end);
+  heap_end += incr;
+
+  if (top != NULL && !(top->size & IN_USE))
+    {
+      /* Extend the free block at the top and move it to the
+         front of the free list. */
+      unlink_large ((struct large_block *) top);
+      set_large_size (top, block_size (top) + incr, IN_USE);
+      large_free_block (top);
+    }
+  else
+    {
+      /* Add a new block at the top. */
+      struct header *h = (struct header *) p;
+
+      h->prev_size = top != NULL ? block_size (top) : 0;
+      h->size = incr | IN_USE;
+      last_block = h;
+      large_free_block (h);
+    }
+  return true;
+}
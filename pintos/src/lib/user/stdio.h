@@ -4,4 +4,8 @@
 int hprintf (int, const char *, ...) PRINTF_FORMAT (2, 3);
 int vhprintf (int, const char *, va_list) PRINTF_FORMAT (2, 0);
 
+/* Buffering of standard output. */
+void stdout_set_buffered (bool);
+void stdout_flush (void);
+
 #endif /* lib/user/stdio.h */
@@ -0,0 +1,165 @@
+#include <synch.h>
+#include <debug.h>
+#include <limits.h>
+#include <stddef.h>
+#include <syscall.h>
+
+/* Locks and condition variables for user programs, built on the
+   futex_wait() and futex_wake() system calls.
+
+   A lock is an int that is 0 when the lock is free, 1 when it is
+   held, and 2 when it is held and some thread may be sleeping on
+   it.  Acquiring a free lock and releasing a lock that nobody is
+   waiting for each take a single atomic instruction, without
+   entering the kernel.  This is "mutex 2" from Ulrich Drepper,
+   "Futexes Are Tricky".
+
+   A condition variable counts signals in SEQ.  A waiter notes
+   SEQ, releases the lock, and sleeps until SEQ changes, so a
+   signal that comes in between is not lost.  Signaling a
+   condition that has no waiters does not enter the kernel. */
+
+/* Atomically replaces *P by NEW if it equals OLD.  Returns the
+   old value of *P. */
+static inline int
+compare_and_swap (int *p, int old, int new)
+{
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "+a" (old), "+m" (*p) : "r" (new) : "memory", "cc");
+  return old;
+}
+
+/* Atomically sets *P to NEW and returns its old value. */
+static inline int
+swap (int *p, int new)
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Atomically adds 1 to *P. */
+static inline void
+increment (int *p)
+{
+  asm volatile ("lock incl %0" : "+m" (*p) : : "memory", "cc");
+}
+
+/* Initializes LOCK.  A lock can be held by at most a single
+   thread at any given time.  Locks are not recursive. */
+void
+lock_init (struct lock *lock)
+{
+  ASSERT (lock != NULL);
+
+  lock->state = 0;
+}
+
+/* Acquires LOCK, sleeping until it becomes available if
+   necessary. */
+void
+lock_acquire (struct lock *lock)
+{
+  int state;
+
+  ASSERT (lock != NULL);
+
+  state = compare_and_swap (&lock->state, 0, 1);
+  if (state == 0)
+    return;
+
+  /* Contended: mark the lock as having waiters and sleep until
+     we manage to take it.  Once we've slept we can't tell
+     whether anyone else is still waiting, so we take it in state
+     2, which costs at most an unneeded futex_wake(). */
+  if (state != 2)
+    state = swap (&lock->state, 2);
+  while (state != 0)
+    {
+      futex_wait (&lock->state, 2);
+      state = swap (&lock->state, 2);
+    }
+}
+
+/* Tries to acquire LOCK and returns true if successful or false
+   on failure.  Never sleeps. */
+bool
+lock_try_acquire (struct lock *lock)
+{
+  ASSERT (lock != NULL);
+
+  return compare_and_swap (&lock->state, 0, 1) == 0;
+}
+
+/* Releases LOCK, which must be held by the current thread, and
+   wakes up one thread waiting for it, if any. */
+void
+lock_release (struct lock *lock)
+{
+  ASSERT (lock != NULL);
+
+  if (swap (&lock->state, 0) == 2)
+    futex_wake (&lock->state, 1);
+}
+
+/* Initializes condition variable COND. */
+void
+cond_init (struct condition *cond)
+{
+  ASSERT (cond != NULL);
+
+  cond->seq = 0;
+  cond->waiters = 0;
+}
+
+/* Atomically releases LOCK and waits for COND to be signaled by
+   some other piece of code.  After COND is signaled, LOCK is
+   reacquired before returning.  LOCK must be held before calling
+   this function.  As with the kernel's condition variables,
+   wakeups may be spurious, so the caller should recheck its
+   condition in a loop. */
+void
+cond_wait (struct condition *cond, struct lock *lock)
+{
+  int seq;
+
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+
+  seq = cond->seq;
+  cond->waiters++;
+  lock_release (lock);
+  futex_wait (&cond->seq, seq);
+  lock_acquire (lock);
+  cond->waiters--;
+}
+
+/* If any threads are waiting on COND (protected by LOCK), then
+   this function wakes up one of them.  LOCK must be held before
+   calling this function. */
+void
+cond_signal (struct condition *cond, struct lock *lock UNUSED)
+{
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+
+  if (cond->waiters > 0)
+    {
+      increment (&cond->seq);
+      futex_wake (&cond->seq, 1);
+    }
+}
+
+/* Wakes up all threads, if any, waiting on COND (protected by
+   LOCK).  LOCK must be held before calling this function. */
+void
+cond_broadcast (struct condition *cond, struct lock *lock UNUSED)
+{
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+
+  if (cond->waiters > 0)
+    {
+      increment (&cond->seq);
+      futex_wake (&cond->seq, INT_MAX);
+    }
+}
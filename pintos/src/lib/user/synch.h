@@ -0,0 +1,29 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Lock. */
+struct lock
+  {
+    int state;                  /* 0=free, 1=held, 2=held with waiters. */
+  };
+
+void lock_init (struct lock *);
+void lock_acquire (struct lock *);
+bool lock_try_acquire (struct lock *);
+void lock_release (struct lock *);
+
+/* Condition variable. */
+struct condition
+  {
+    int seq;                    /* Bumped by each signal. */
+    int waiters;                /* Number of waiting threads. */
+  };
+
+void cond_init (struct condition *);
+void cond_wait (struct condition *, struct lock *);
+void cond_signal (struct condition *, struct lock *);
+void cond_broadcast (struct condition *, struct lock *);
+
+#endif /* lib/user/synch.h */
@@ -1,4 +1,5 @@
 #include <syscall.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
 /* Invokes syscall NUMBER, passing no arguments, and returns the
@@ -64,6 +65,7 @@
 void
 halt (void) 
 {
+  stdout_flush ();
   syscall0 (SYS_HALT);
   NOT_REACHED ();
 }
@@ -71,6 +73,7 @@ halt (void)
 void
 exit (int status)
 {
+  stdout_flush ();
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
@@ -78,12 +81,14 @@ exit (int status)
 pid_t
 exec (const char *file)
 {
+  stdout_flush ();
   return (pid_t) syscall1 (SYS_EXEC, file);
 }
 
 int
 wait (pid_t pid)
 {
+  stdout_flush ();
   return syscall1 (SYS_WAIT, pid);
 }
 
@@ -182,3 +187,94 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+pipe (int fds[2])
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+void *
+sbrk (intptr_t increment)
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+int
+futex_wait (int *addr, int val)
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, val);
+}
+
+int
+futex_wake (int *addr, int n)
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, n);
+}
+
+int
+copy_file_range (int in_fd, int out_fd, unsigned length)
+{
+  return syscall3 (SYS_COPY_FILE_RANGE, in_fd, out_fd, length);
+}
+
+int
+readv (int fd, const struct iovec *iov, int cnt)
+{
+  return syscall3 (SYS_READV, fd, iov, cnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int cnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, cnt);
+}
+
+int
+fsync (int fd)
+{
+  return syscall1 (SYS_FSYNC, fd);
+}
+
+int
+io_setup (struct io_ring *ring)
+{
+  return syscall1 (SYS_IO_SETUP, ring);
+}
+
+int
+io_submit (int cnt)
+{
+  return syscall1 (SYS_IO_SUBMIT, cnt);
+}
+
+int
+io_wait (int min_complete)
+{
+  return syscall1 (SYS_IO_WAIT, min_complete);
+}
+
+int
+getstats (pid_t pid, struct thread_stat *st)
+{
+  return syscall2 (SYS_GETSTATS, pid, st);
+}
+
+/* Entry point of every thread started by thread_create(). */
+static void
+thread_entry (thread_func *func, void *arg)
+{
+  exit (func (arg));
+}
+
+tid_t
+thread_create (thread_func *func, void *arg)
+{
+  return syscall3 (SYS_THREAD_CREATE, thread_entry, func, arg);
+}
+
+int
+thread_join (tid_t tid)
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
@@ -1,13 +1,25 @@
 #ifndef __LIB_USER_SYSCALL_H
 #define __LIB_USER_SYSCALL_H
 
+#include <aio.h>
+#include <iovec.h>
+#include <threadstat.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
+/* A function run by a thread.  Its return value becomes the
+   thread's exit status. */
+typedef int thread_func (void *aux);
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
@@ -45,4 +57,20 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int pipe (int fds[2]);
+void *sbrk (intptr_t increment);
+int futex_wait (int *addr, int val);
+int futex_wake (int *addr, int n);
+tid_t thread_create (thread_func *, void *);
+int thread_join (tid_t);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+int readv (int fd, const struct iovec *, int cnt);
+int writev (int fd, const struct iovec *, int cnt);
+int fsync (int fd);
+int io_setup (struct io_ring *);
+int io_submit (int cnt);
+int io_wait (int min_complete);
+int getstats (pid_t, struct thread_stat *);
+
 #endif /* lib/user/syscall.h */
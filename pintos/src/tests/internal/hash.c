@@ -0,0 +1,258 @@
+/* Test program for lib/kernel/ohash.c, with a benchmark that
+   compares it to lib/kernel/hash.c.
+
+   Applies random insertions, replacements, deletions, and
+   lookups to an open-addressing hash table and checks every
+   result against a record of which values should be in it,
+   first with a good hash function and then with one that puts
+   every value in one of a few home slots.  Then times the same
+   inserts, lookups, and deletions of BENCH_SIZE elements in both
+   kinds of hash table.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <ohash.h>
+#include <random.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Number of distinct values in the correctness tests. */
+#define MAX_SIZE 4096
+
+/* Number of elements in the benchmark, and number of times it
+   looks up each one. */
+#define BENCH_SIZE 16384
+#define BENCH_LOOKUPS 8
+
+/* A hash table element. */
+struct value
+  {
+    struct hash_elem elem;      /* Hash element. */
+    int value;                  /* Item value. */
+    bool in_table;              /* Should this value be in the table? */
+  };
+
+static struct value values[BENCH_SIZE];
+
+static void test_ohash (hash_hash_func *, int size);
+static void verify_ohash (struct ohash *, int size);
+static void report (const char *table, const char *name, int64_t start);
+static void bench_ohash (void);
+static void bench_hash (void);
+static unsigned value_hash (const struct hash_elem *, void *);
+static unsigned value_hash_bad (const struct hash_elem *, void *);
+static bool value_less (const struct hash_elem *, const struct hash_elem *,
+                        void *);
+
+/* Test the open-addressing hash table and compare it to the
+   chained one. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size tables:");
+  for (size = 1; size <= MAX_SIZE; size *= 4)
+    {
+      printf (" %d", size);
+      test_ohash (value_hash, size);
+    }
+  printf (" with collisions");
+  test_ohash (value_hash_bad, 256);
+  printf (" done\n");
+
+  bench_ohash ();
+  bench_hash ();
+  printf ("ohash: PASS\n");
+}
+
+/* Applies random operations on values 0...SIZE to an
+   open-addressing table that hashes with HASH, checking each
+   result. */
+static void
+test_ohash (hash_hash_func *hash, int size)
+{
+  struct ohash h;
+  int i;
+
+  ASSERT (ohash_init (&h, hash, value_less, NULL));
+  for (i = 0; i < size; i++)
+    {
+      values[i].value = i;
+      values[i].in_table = false;
+    }
+
+  for (i = 0; i < size * 32; i++)
+    {
+      struct value *v = &values[random_ulong () % size];
+      struct value probe;
+      struct hash_elem *e;
+
+      probe.value = v->value;
+      switch (random_ulong () % 4)
+        {
+        case 0:
+          e = ohash_insert (&h, &v->elem);
+          ASSERT (e == (v->in_table ? &v->elem : NULL));
+          v->in_table = true;
+          break;
+
+        case 1:
+          e = ohash_replace (&h, &v->elem);
+          ASSERT (e == (v->in_table ? &v->elem : NULL));
+          v->in_table = true;
+          break;
+
+        case 2:
+          e = ohash_delete (&h, &probe.elem);
+          ASSERT (e == (v->in_table ? &v->elem : NULL));
+          v->in_table = false;
+          break;
+
+        case 3:
+          e = ohash_find (&h, &probe.elem);
+          ASSERT (e == (v->in_table ? &v->elem : NULL));
+          probe.value += size;
+          ASSERT (ohash_find (&h, &probe.elem) == NULL);
+          break;
+        }
+
+      if (i % size == 0)
+        verify_ohash (&h, size);
+    }
+  verify_ohash (&h, size);
+
+  ohash_clear (&h, NULL);
+  ASSERT (ohash_empty (&h));
+  ohash_destroy (&h, NULL);
+}
+
+/* Verifies that H contains exactly the values among 0...SIZE
+   that should be in it. */
+static void
+verify_ohash (struct ohash *h, int size)
+{
+  struct ohash_iterator i;
+  int expected = 0;
+  int found = 0;
+  int j;
+
+  for (j = 0; j < size; j++)
+    if (values[j].in_table)
+      expected++;
+
+  ohash_first (&i, h);
+  while (ohash_next (&i))
+    {
+      struct value *v = hash_entry (ohash_cur (&i), struct value, elem);
+      ASSERT (v->in_table);
+      found++;
+    }
+  ASSERT (found == expected);
+  ASSERT (ohash_size (h) == (size_t) expected);
+}
+
+/* Prints the number of timer ticks since START taken by the
+   benchmark phase named NAME. */
+static void
+report (const char *table, const char *name, int64_t start)
+{
+  printf ("%s: %s: %"PRId64" ticks\n", table, name, timer_elapsed (start));
+}
+
+/* Times inserting, looking up, and deleting BENCH_SIZE elements
+   in an open-addressing hash table. */
+static void
+bench_ohash (void)
+{
+  struct ohash h;
+  int64_t start;
+  int i, j;
+
+  for (i = 0; i < BENCH_SIZE; i++)
+    values[i].value = i;
+  ASSERT (ohash_init (&h, value_hash, value_less, NULL));
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_SIZE; i++)
+    ohash_insert (&h, &values[i].elem);
+  report ("ohash", "insert", start);
+
+  start = timer_ticks ();
+  for (j = 0; j < BENCH_LOOKUPS; j++)
+    for (i = 0; i < BENCH_SIZE; i++)
+      ASSERT (ohash_find (&h, &values[i].elem) != NULL);
+  report ("ohash", "find", start);
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_SIZE; i++)
+    ohash_delete (&h, &values[i].elem);
+  report ("ohash", "delete", start);
+
+  ohash_destroy (&h, NULL);
+}
+
+/* Times inserting, looking up, and deleting BENCH_SIZE elements
+   in a chained hash table. */
+static void
+bench_hash (void)
+{
+  struct hash h;
+  int64_t start;
+  int i, j;
+
+  for (i = 0; i < BENCH_SIZE; i++)
+    values[i].value = i;
+  ASSERT (hash_init (&h, value_hash, value_less, NULL));
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_SIZE; i++)
+    hash_insert (&h, &values[i].elem);
+  report ("hash", "insert", start);
+
+  start = timer_ticks ();
+  for (j = 0; j < BENCH_LOOKUPS; j++)
+    for (i = 0; i < BENCH_SIZE; i++)
+      ASSERT (hash_find (&h, &values[i].elem) != NULL);
+  report ("hash", "find", start);
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_SIZE; i++)
+    hash_delete (&h, &values[i].elem);
+  report ("hash", "delete", start);
+
+  hash_destroy (&h, NULL);
+}
+
+/* Returns a hash of value E. */
+static unsigned
+value_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct value, elem)->value);
+}
+
+/* Returns a poor hash of value E, with many collisions. */
+static unsigned
+value_hash_bad (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_entry (e, struct value, elem)->value % 7;
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = hash_entry (a_, struct value, elem);
+  const struct value *b = hash_entry (b_, struct value, elem);
+
+  return a->value < b->value;
+}
@@ -0,0 +1,156 @@
+/* Test program for lib/kernel/heap.c.
+
+   Pushes values in random order into heaps of various sizes,
+   reorders and removes some at random, and checks that popping
+   the rest returns them in order.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <heap.h>
+#include <limits.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Maximum number of elements in a heap that we will test. */
+#define MAX_SIZE 256
+
+/* A heap element. */
+struct value
+  {
+    struct heap_elem elem;      /* Heap element. */
+    int value;                  /* Item value. */
+    bool in_heap;               /* Is this value in the heap? */
+  };
+
+static void shuffle (struct value[], size_t);
+static bool value_less (const struct heap_elem *, const struct heap_elem *,
+                        void *);
+static void verify_heap (struct heap *);
+
+/* Test the heap implementation. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size heaps:");
+  for (size = 0; size < MAX_SIZE; size = size * 3 / 2 + 1)
+    {
+      int repeat;
+
+      printf (" %d", size);
+      for (repeat = 0; repeat < 10; repeat++)
+        {
+          static struct value values[MAX_SIZE];
+          struct heap heap;
+          int i, prev, remaining;
+
+          /* Push values 0...SIZE in random order. */
+          for (i = 0; i < size; i++)
+            {
+              values[i].value = i;
+              values[i].in_heap = true;
+            }
+          shuffle (values, size);
+          heap_init (&heap, value_less, NULL);
+          for (i = 0; i < size; i++)
+            ASSERT (heap_push (&heap, &values[i].elem));
+          ASSERT (heap_size (&heap) == (size_t) size);
+          verify_heap (&heap);
+
+          /* Change, or remove, some of them. */
+          for (i = 0; i < size / 2; i++)
+            {
+              struct value *v = &values[random_ulong () % size];
+              if (!v->in_heap)
+                continue;
+              switch (random_ulong () % 3)
+                {
+                case 0:
+                  v->value -= (int) (random_ulong () % (size + 1));
+                  heap_decrease_key (&heap, &v->elem);
+                  break;
+                case 1:
+                  v->value += (int) (random_ulong () % (size + 1));
+                  heap_update (&heap, &v->elem);
+                  break;
+                case 2:
+                  heap_remove (&heap, &v->elem);
+                  v->in_heap = false;
+                  break;
+                }
+              verify_heap (&heap);
+            }
+
+          /* Pop the rest and check that they come out in order. */
+          remaining = 0;
+          for (i = 0; i < size; i++)
+            if (values[i].in_heap)
+              remaining++;
+          ASSERT (heap_size (&heap) == (size_t) remaining);
+          prev = INT_MIN;
+          while (!heap_empty (&heap))
+            {
+              struct value *v = heap_entry (heap_pop (&heap),
+                                            struct value, elem);
+              ASSERT (v->in_heap);
+              ASSERT (v->value >= prev);
+              prev = v->value;
+              v->in_heap = false;
+            }
+          for (i = 0; i < size; i++)
+            ASSERT (!values[i].in_heap);
+          heap_destroy (&heap);
+        }
+    }
+
+  printf (" done\n");
+  printf ("heap: PASS\n");
+}
+
+/* Shuffles the CNT elements in ARRAY into random order. */
+static void
+shuffle (struct value *array, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED)
+{
+  const struct value *a = heap_entry (a_, struct value, elem);
+  const struct value *b = heap_entry (b_, struct value, elem);
+
+  return a->value < b->value;
+}
+
+/* Verifies that every element of HEAP knows its own position
+   and is not less than its parent. */
+static void
+verify_heap (struct heap *heap)
+{
+  size_t i;
+
+  for (i = 0; i < heap->elem_cnt; i++)
+    {
+      ASSERT (heap->elems[i]->idx == i);
+      ASSERT (i == 0 || !value_less (heap->elems[i],
+                                     heap->elems[(i - 1) / 2], NULL));
+    }
+}
@@ -0,0 +1,155 @@
+/* Test program for lib/kernel/lz.c.
+
+   Compresses inputs of various sizes and redundancy, from runs
+   of one byte to random noise, checks that each decompresses to
+   the original, and checks that decompression stays inside its
+   buffers when given truncated or damaged input.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <lz.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Largest input that we will test. */
+#define MAX_SIZE 8192
+
+/* Room for the worst-case expansion of MAX_SIZE bytes. */
+#define MAX_COMPRESSED (MAX_SIZE + MAX_SIZE / 255 + 16)
+
+/* Guard bytes around the decompression buffer. */
+#define GUARD 16
+
+static void fill (unsigned char *, size_t, int redundancy);
+static void check_damaged (const unsigned char *, size_t);
+
+static unsigned char work[LZ_WORK_SIZE];
+static unsigned char input[MAX_SIZE];
+static unsigned char compressed[MAX_COMPRESSED];
+static unsigned char output[GUARD + MAX_SIZE + GUARD];
+
+/* Test the compressor. */
+void
+test (void)
+{
+  int size;
+
+  printf ("testing various size inputs:");
+  for (size = 0; size <= MAX_SIZE; size = size < 4 ? size + 1 : size * 2)
+    {
+      int redundancy;
+
+      printf (" %d", size);
+      for (redundancy = 0; redundancy <= 4; redundancy++)
+        {
+          size_t csize, dsize;
+
+          fill (input, size, redundancy);
+          csize = lz_compress (compressed, sizeof compressed,
+                               input, size, work);
+          ASSERT (csize > 0);
+
+          /* Runs of a single byte must compress well. */
+          if (redundancy == 0 && size >= 1024)
+            {
+              ASSERT (csize < (size_t) size / 32);
+            }
+
+          memset (output, 0xcc, sizeof output);
+          dsize = lz_decompress (output + GUARD, size, compressed, csize);
+          ASSERT (dsize == (size_t) size);
+          ASSERT (!memcmp (output + GUARD, input, size));
+
+          /* An output buffer one byte short must be refused. */
+          if (size > 0)
+            {
+              ASSERT (lz_decompress (output + GUARD, size - 1,
+                                     compressed, csize) == 0);
+            }
+
+          /* So must a compressed buffer one byte short. */
+          if (csize > 1)
+            {
+              ASSERT (lz_compress (compressed, csize - 1,
+                                   input, size, work) == 0);
+            }
+
+          check_damaged (compressed, csize);
+        }
+    }
+
+  printf (" done\n");
+  printf ("lz: PASS\n");
+}
+
+/* Fills the SIZE bytes at BUF with data that is more random as
+   REDUNDANCY goes from 0, a run of one byte, to 4, noise. */
+static void
+fill (unsigned char *buf, size_t size, int redundancy)
+{
+  static const char *words[] = {"page ", "swap ", "frame ", "disk ",
+                                "zero ", "slot "};
+  size_t i;
+
+  for (i = 0; i < size; )
+    switch (redundancy)
+      {
+      case 0:
+        buf[i++] = 'x';
+        break;
+      case 1:
+        buf[i] = i % 7;
+        i++;
+        break;
+      case 2:
+        {
+          const char *w = words[random_ulong () % 6];
+          while (*w != '\0' && i < size)
+            buf[i++] = *w++;
+        }
+        break;
+      case 3:
+        buf[i++] = random_ulong () % 4;
+        break;
+      default:
+        buf[i++] = random_ulong ();
+        break;
+      }
+}
+
+/* Decompresses truncated and randomly damaged copies of the CSIZE
+   bytes at DATA, checking that the guard bytes around the output
+   buffer survive. */
+static void
+check_damaged (const unsigned char *data, size_t csize)
+{
+  static unsigned char copy[MAX_COMPRESSED];
+  int round;
+
+  for (round = 0; round < 8; round++)
+    {
+      size_t len = csize;
+      size_t i;
+
+      memcpy (copy, data, csize);
+      if (round % 2 == 0)
+        len = csize > 0 ? random_ulong () % csize : 0;
+      else if (csize > 0)
+        copy[random_ulong () % csize] = random_ulong ();
+
+      memset (output, 0xcc, sizeof output);
+      ASSERT (lz_decompress (output + GUARD, MAX_SIZE, copy, len)
+              <= MAX_SIZE);
+      for (i = 0; i < GUARD; i++)
+        {
+          ASSERT (output[i] == 0xcc);
+          ASSERT (output[GUARD + MAX_SIZE + i] == 0xcc);
+        }
+    }
+}
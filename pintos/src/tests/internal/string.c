@@ -0,0 +1,317 @@
+/* Test program for the block and string functions in
+   lib/string.c.
+
+   Checks memcpy(), memmove(), memset(), memcmp(), and strlen()
+   for every combination of source and destination alignment and
+   for sizes from 0 bytes to 64 kB, making sure that no byte
+   outside the block is touched.  Then times memcpy() and
+   memset() against byte-at-a-time versions.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Largest block that we will test. */
+#define MAX_SIZE 65536
+
+/* Bytes of guard space on each side of a block. */
+#define GUARD 16
+
+/* Size of each buffer, with room for guards and misalignment. */
+#define BUF_SIZE (MAX_SIZE + 4 * GUARD)
+
+/* Value of bytes that should not be modified. */
+#define GUARD_BYTE 0xa5
+
+static uint8_t *buf_a, *buf_b;
+
+static void test_sizes (void (*) (size_t size, int a_ofs, int b_ofs));
+static void test_offsets (void (*) (size_t size, int a_ofs, int b_ofs),
+                          size_t size);
+static void test_memcpy (size_t, int, int);
+static void test_memmove (size_t, int, int);
+static void test_memset (size_t, int, int);
+static void test_memcmp (size_t, int, int);
+static void test_strlen (size_t, int, int);
+static void benchmark (void);
+static void set_guards (uint8_t *, size_t);
+static void verify_guards (const uint8_t *, size_t);
+
+/* Tests the block and string functions. */
+void
+test (void)
+{
+  buf_a = palloc_get_multiple (PAL_ASSERT, DIV_ROUND_UP (BUF_SIZE, PGSIZE));
+  buf_b = palloc_get_multiple (PAL_ASSERT, DIV_ROUND_UP (BUF_SIZE, PGSIZE));
+
+  printf ("testing memcpy...\n");
+  test_sizes (test_memcpy);
+  printf ("testing memmove...\n");
+  test_sizes (test_memmove);
+  printf ("testing memset...\n");
+  test_sizes (test_memset);
+  printf ("testing memcmp...\n");
+  test_sizes (test_memcmp);
+  printf ("testing strlen...\n");
+  test_sizes (test_strlen);
+
+  benchmark ();
+
+  printf ("string: PASS\n");
+}
+
+/* Calls TEST for SIZE with every combination of offsets from
+   word alignment for two blocks. */
+static void
+test_offsets (void (*test) (size_t size, int a_ofs, int b_ofs), size_t size)
+{
+  int a_ofs, b_ofs;
+
+  for (a_ofs = 0; a_ofs < 4; a_ofs++)
+    for (b_ofs = 0; b_ofs < 4; b_ofs++)
+      test (size, a_ofs, b_ofs);
+}
+
+/* Calls TEST for every size from 0 to 256 bytes and then for
+   sizes around each power of 2 up to MAX_SIZE, each with every
+   combination of offsets from word alignment for two blocks. */
+static void
+test_sizes (void (*test) (size_t size, int a_ofs, int b_ofs))
+{
+  size_t size;
+
+  for (size = 0; size <= 256; size++)
+    test_offsets (test, size);
+  for (size = 512; size <= MAX_SIZE; size *= 2)
+    {
+      test_offsets (test, size - 1);
+      test_offsets (test, size);
+      if (size < MAX_SIZE)
+        test_offsets (test, size + 1);
+    }
+}
+
+/* Copies SIZE random bytes from offset SRC_OFS in one buffer to
+   offset DST_OFS in another and checks the result. */
+static void
+test_memcpy (size_t size, int dst_ofs, int src_ofs)
+{
+  uint8_t *dst = buf_a + 2 * GUARD + dst_ofs;
+  uint8_t *src = buf_b + 2 * GUARD + src_ofs;
+  size_t i;
+
+  set_guards (dst, size);
+  random_bytes (src, size);
+  ASSERT (memcpy (dst, src, size) == dst);
+  for (i = 0; i < size; i++)
+    ASSERT (dst[i] == src[i]);
+  verify_guards (dst, size);
+}
+
+/* Moves SIZE random bytes at offset SRC_OFS in a buffer down and
+   then up by DISTANCE + 1 bytes, so that the source and
+   destination overlap, and checks the result against a copy of
+   the buffer in which the same move was done one byte at a
+   time. */
+static void
+test_memmove (size_t size, int src_ofs, int distance)
+{
+  int dir;
+
+  for (dir = -1; dir <= 1; dir += 2)
+    {
+      uint8_t *src = buf_a + 2 * GUARD + src_ofs;
+      uint8_t *dst = src + dir * (distance + 1);
+      uint8_t *lo = (dir < 0 ? dst : src) - GUARD;
+      uint8_t *hi = (dir < 0 ? src : dst) + size + GUARD;
+      uint8_t *p, *q;
+      size_t i;
+
+      random_bytes (lo, hi - lo);
+      for (p = lo; p < hi; p++)
+        buf_b[p - buf_a] = *p;
+
+      ASSERT (memmove (dst, src, size) == dst);
+      p = buf_b + (dst - buf_a);
+      q = buf_b + (src - buf_a);
+      if (dir < 0)
+        for (i = 0; i < size; i++)
+          p[i] = q[i];
+      else
+        for (i = size; i-- > 0; )
+          p[i] = q[i];
+
+      for (p = lo; p < hi; p++)
+        ASSERT (*p == buf_b[p - buf_a]);
+    }
+}
+
+/* Sets SIZE bytes at offset DST_OFS in a buffer to a value
+   chosen based on VALUE_OFS and checks the result. */
+static void
+test_memset (size_t size, int dst_ofs, int value_ofs)
+{
+  uint8_t *dst = buf_a + 2 * GUARD + dst_ofs;
+  int value = value_ofs == 0 ? 0 : value_ofs * 0x55 + 0x100;
+  size_t i;
+
+  set_guards (dst, size);
+  ASSERT (memset (dst, value, size) == dst);
+  for (i = 0; i < size; i++)
+    ASSERT (dst[i] == (uint8_t) value);
+  verify_guards (dst, size);
+}
+
+/* Compares two SIZE-byte blocks at offsets A_OFS and B_OFS in
+   different buffers, first equal, then with a difference in
+   the first, a random, or the last byte. */
+static void
+test_memcmp (size_t size, int a_ofs, int b_ofs)
+{
+  uint8_t *a = buf_a + 2 * GUARD + a_ofs;
+  uint8_t *b = buf_b + 2 * GUARD + b_ofs;
+  size_t where[3];
+  int i;
+
+  random_bytes (a, size);
+  memcpy (b, a, size);
+  ASSERT (memcmp (a, b, size) == 0);
+  if (size == 0)
+    return;
+
+  where[0] = 0;
+  where[1] = random_ulong () % size;
+  where[2] = size - 1;
+  for (i = 0; i < 3; i++)
+    {
+      uint8_t old = b[where[i]];
+
+      b[where[i]] = old ^ 0x80;
+      if (old & 0x80)
+        {
+          ASSERT (memcmp (a, b, size) > 0);
+          ASSERT (memcmp (b, a, size) < 0);
+        }
+      else
+        {
+          ASSERT (memcmp (a, b, size) < 0);
+          ASSERT (memcmp (b, a, size) > 0);
+        }
+      b[where[i]] = old;
+    }
+}
+
+/* Checks strlen() on a string of SIZE nonnull characters at
+   offset OFS in a buffer.  Ignores its third argument. */
+static void
+test_strlen (size_t size, int ofs, int unused UNUSED)
+{
+  char *s = (char *) buf_a + 2 * GUARD + ofs;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    s[i] = (random_ulong () % 255) + 1;
+  s[size] = '\0';
+  ASSERT (strlen (s) == size);
+}
+
+/* Reference implementations, for timing. */
+static void
+byte_memcpy (uint8_t *dst, const uint8_t *src, size_t size)
+{
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+static void
+byte_memset (uint8_t *dst, int value, size_t size)
+{
+  while (size-- > 0)
+    *dst++ = value;
+}
+
+/* Prints the number of timer ticks that it takes to memcpy()
+   and memset() a total of 1 MB in blocks of various sizes,
+   aligned and misaligned, next to the time for the
+   byte-at-a-time versions. */
+static void
+benchmark (void)
+{
+  static const size_t sizes[] = {16, 64, 512, 4096, MAX_SIZE};
+  const size_t total = 1024 * 1024;
+  size_t i;
+
+  printf ("%6s %5s %14s %14s %14s %14s\n", "bytes", "align",
+          "memcpy", "byte copy", "memset", "byte set");
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t size = sizes[i];
+      int ofs;
+
+      for (ofs = 0; ofs < 2; ofs++)
+        {
+          uint8_t *dst = buf_a + 2 * GUARD + ofs;
+          uint8_t *src = buf_b + 2 * GUARD;
+          int64_t t[4];
+          size_t n;
+
+          t[0] = timer_ticks ();
+          for (n = 0; n < total; n += size)
+            memcpy (dst, src, size);
+          t[0] = timer_elapsed (t[0]);
+
+          t[1] = timer_ticks ();
+          for (n = 0; n < total; n += size)
+            byte_memcpy (dst, src, size);
+          t[1] = timer_elapsed (t[1]);
+
+          t[2] = timer_ticks ();
+          for (n = 0; n < total; n += size)
+            memset (dst, n, size);
+          t[2] = timer_elapsed (t[2]);
+
+          t[3] = timer_ticks ();
+          for (n = 0; n < total; n += size)
+            byte_memset (dst, n, size);
+          t[3] = timer_elapsed (t[3]);
+
+          printf ("%6zu %5s %8"PRId64" ticks %8"PRId64" ticks "
+                  "%8"PRId64" ticks %8"PRId64" ticks\n",
+                  size, ofs ? "no" : "yes", t[0], t[1], t[2], t[3]);
+        }
+    }
+}
+
+/* Sets the GUARD bytes on each side of the SIZE-byte block at P
+   to GUARD_BYTE. */
+static void
+set_guards (uint8_t *p, size_t size)
+{
+  size_t i;
+
+  for (i = 1; i <= GUARD; i++)
+    p[-i] = p[size - 1 + i] = GUARD_BYTE;
+}
+
+/* Verifies that the GUARD bytes on each side of the SIZE-byte
+   block at P are still GUARD_BYTE. */
+static void
+verify_guards (const uint8_t *p, size_t size)
+{
+  size_t i;
+
+  for (i = 1; i <= GUARD; i++)
+    ASSERT (p[-i] == GUARD_BYTE && p[size - 1 + i] == GUARD_BYTE);
+}
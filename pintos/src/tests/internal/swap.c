@@ -0,0 +1,173 @@
+/* Test program for vm/swap.c.
+
+   Swaps out pages of zeros, pages that compress well, and pages
+   of noise, which go to the zero, compressed cache, and disk
+   tiers respectively, swaps them back in, in a different order
+   from the one they went out in, and checks that each comes back
+   as it was.  Then does the same with enough compressible pages
+   to fill the cache, so that the rest of them go to disk, and
+   checks that freed slots and disk pages are reused.
+
+   Must be run in a kernel built with VM and given a swap device
+   of at least PAGE_CNT pages, since pages of noise can only go
+   to disk.  The swap statistics printed at power off show how
+   many pages went to each tier.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/palloc.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+#include "vm/swap.h"
+
+/* Number of pages swapped out at once.  Comfortably more
+   compressible pages than fit in the cache. */
+#define PAGE_CNT 240
+
+/* Kinds of page content. */
+enum kind
+  {
+    ZERO,                       /* All zeros. */
+    WORDS,                      /* Words from a short list. */
+    NOISE,                      /* Pseudo-random bytes. */
+    KIND_CNT
+  };
+
+static void round_trip (enum kind (*) (int));
+static enum kind mixed_kind (int);
+static enum kind words_kind (int);
+static void fill (uint8_t *, enum kind, int seed);
+static void check (const uint8_t *, enum kind, int seed);
+
+static swap_slot_t slots[PAGE_CNT];
+static uint8_t *page;
+
+/* Test the swap layer. */
+void
+test (void)
+{
+  ASSERT (block_get_role (BLOCK_SWAP) != NULL);
+  ASSERT (block_size (block_get_role (BLOCK_SWAP))
+          >= PAGE_CNT * (PGSIZE / BLOCK_SECTOR_SIZE));
+  page = palloc_get_page (PAL_ASSERT);
+
+  printf ("testing mixed pages:");
+  round_trip (mixed_kind);
+  printf (" done\n");
+
+  printf ("testing compressible pages:");
+  round_trip (words_kind);
+  printf (" done\n");
+
+  palloc_free_page (page);
+  printf ("swap: PASS\n");
+}
+
+/* Swaps out PAGE_CNT pages, the Ith one of kind KIND(I), then
+   swaps in the odd-numbered ones from last to first and frees
+   the even-numbered ones without reading them.  Does it twice,
+   to check that the slots and disk pages freed the first time
+   can be used again. */
+static void
+round_trip (enum kind (*kind) (int))
+{
+  int round;
+
+  for (round = 0; round < 2; round++)
+    {
+      int seed = round * PAGE_CNT;
+      int i;
+
+      printf (" %d", round);
+      for (i = 0; i < PAGE_CNT; i++)
+        {
+          fill (page, kind (i), seed + i);
+          slots[i] = swap_out (page);
+          ASSERT (slots[i] != SWAP_ERROR);
+        }
+
+      for (i = PAGE_CNT - 1; i >= 0; i--)
+        if (i % 2)
+          {
+            memset (page, 0xcc, PGSIZE);
+            swap_in (slots[i], page);
+            check (page, kind (i), seed + i);
+          }
+        else
+          swap_free (slots[i]);
+    }
+}
+
+/* Cycles through the kinds of page. */
+static enum kind
+mixed_kind (int i)
+{
+  return i % KIND_CNT;
+}
+
+/* Returns WORDS for every page. */
+static enum kind
+words_kind (int i UNUSED)
+{
+  return WORDS;
+}
+
+/* Returns the next value of the generator whose state is at
+   STATE, which is the same for every run, unlike random_ulong()
+   after random_init(). */
+static unsigned
+next (unsigned *state)
+{
+  *state = *state * 1103515245 + 12345;
+  return *state >> 16;
+}
+
+/* Fills the page at P with content of the given KIND, which
+   depends on SEED. */
+static void
+fill (uint8_t *p, enum kind kind, int seed)
+{
+  static const char *words[] = {"page ", "swap ", "frame ", "disk ",
+                                "zero ", "slot "};
+  unsigned state = seed;
+  size_t i;
+
+  switch (kind)
+    {
+    case ZERO:
+      memset (p, 0, PGSIZE);
+      break;
+
+    case WORDS:
+      for (i = 0; i < PGSIZE; )
+        {
+          const char *w = words[next (&state) % 6];
+          while (*w != '\0' && i < PGSIZE)
+            p[i++] = *w++;
+        }
+      break;
+
+    default:
+      for (i = 0; i < PGSIZE; i++)
+        p[i] = next (&state);
+      break;
+    }
+}
+
+/* Checks that the page at P is what fill() put there for KIND
+   and SEED. */
+static void
+check (const uint8_t *p, enum kind kind, int seed)
+{
+  static uint8_t expected[PGSIZE];
+
+  fill (expected, kind, seed);
+  ASSERT (!memcmp (p, expected, PGSIZE));
+}
@@ -0,0 +1,132 @@
+/* Test program for lib/kernel/wheel.c.
+
+   Adds timers due at random ticks, near and far, to a timing
+   wheel, cancels some of them, and advances the clock in steps
+   of random size, checking that each remaining timer fires
+   exactly once, at the right time and in order.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <wheel.h>
+#include "threads/test.h"
+
+/* Number of timers in each round of the test. */
+#define TIMER_CNT 512
+
+/* A timer. */
+struct timer
+  {
+    struct wheel_elem elem;     /* Wheel element. */
+    bool pending;               /* Should this timer still fire? */
+    bool fired;                 /* Has it fired? */
+  };
+
+/* State checked as timers fire. */
+struct clock
+  {
+    int64_t low;                /* Ticks before this have passed. */
+    int64_t high;               /* Ticks after this have not. */
+    int64_t last;               /* Due tick of last timer to fire. */
+  };
+
+static void add_timers (struct wheel *, struct timer[], int64_t base,
+                        int64_t range);
+static void fire (struct wheel_elem *, void *clock);
+
+/* Test the timing wheel implementation. */
+void
+test (void)
+{
+  static const int64_t ranges[] = {10, 100, 5000, 300000, 20000000};
+  static struct timer timers[TIMER_CNT];
+  size_t r;
+
+  printf ("testing timers with various ranges:");
+  for (r = 0; r < sizeof ranges / sizeof *ranges; r++)
+    {
+      int64_t range = ranges[r];
+      int64_t start = random_ulong () % 1000000;
+      struct wheel wheel;
+      struct clock clock;
+      int i;
+
+      printf (" %"PRId64, range);
+      wheel_init (&wheel, start);
+      add_timers (&wheel, timers, start, range);
+
+      /* Cancel about a quarter of them. */
+      for (i = 0; i < TIMER_CNT; i++)
+        if (random_ulong () % 4 == 0)
+          {
+            wheel_cancel (&wheel, &timers[i].elem);
+            timers[i].pending = false;
+          }
+
+      /* Advance the clock until all have fired. */
+      clock.last = start;
+      clock.low = start;
+      while (!wheel_empty (&wheel))
+        {
+          clock.high = clock.low + 1 + random_ulong () % (range / 8 + 1);
+          wheel_advance (&wheel, clock.high, fire, &clock);
+          ASSERT (wheel.now == clock.high);
+          clock.low = clock.high;
+        }
+      for (i = 0; i < TIMER_CNT; i++)
+        ASSERT (timers[i].fired == timers[i].pending);
+
+      /* Timers added for ticks already past fire on the next
+         advance. */
+      timers[0].fired = false;
+      timers[0].pending = true;
+      wheel_add (&wheel, &timers[0].elem, clock.low - 5);
+      clock.last = clock.low - 5;
+      clock.high = clock.low + 1;
+      wheel_advance (&wheel, clock.high, fire, &clock);
+      ASSERT (timers[0].fired);
+      ASSERT (wheel_empty (&wheel));
+    }
+
+  printf (" done\n");
+  printf ("wheel: PASS\n");
+}
+
+/* Adds each of the TIMER_CNT timers in TIMERS to W, due at a
+   random tick between BASE + 1 and BASE + RANGE. */
+static void
+add_timers (struct wheel *w, struct timer timers[], int64_t base,
+            int64_t range)
+{
+  int i;
+
+  for (i = 0; i < TIMER_CNT; i++)
+    {
+      timers[i].pending = true;
+      timers[i].fired = false;
+      wheel_add (w, &timers[i].elem, base + 1 + random_ulong () % range);
+    }
+  ASSERT (wheel_size (w) == TIMER_CNT);
+}
+
+/* Checks that timer E_ fires once, during the advance described
+   by CLOCK_, and no earlier than the one before it. */
+static void
+fire (struct wheel_elem *e, void *clock_)
+{
+  struct timer *t = wheel_entry (e, struct timer, elem);
+  struct clock *clock = clock_;
+
+  ASSERT (t->pending && !t->fired);
+  ASSERT (e->expires > clock->low || e->expires == clock->last);
+  ASSERT (e->expires <= clock->high);
+  ASSERT (e->expires >= clock->last);
+  clock->last = e->expires;
+  t->fired = true;
+}
@@ -33,7 +33,7 @@ test_priority_fifo (void)
 {
   struct simple_thread_data data[THREAD_CNT];
   struct lock lock;
-  int *output, *op;
+  int *buffer, *output, *op;
   int i, cnt;
 
   /* This test does not work with the MLFQS. */
@@ -46,7 +46,7 @@ test_priority_fifo (void)
        THREAD_CNT, ITER_CNT);
   msg ("If the order varies then there is a bug.");
 
-  output = op = malloc (sizeof *output * THREAD_CNT * ITER_CNT * 2);
+  buffer = output = op = malloc (sizeof *output * THREAD_CNT * ITER_CNT * 2);
   ASSERT (output != NULL);
   lock_init (&lock);
 
@@ -81,6 +81,7 @@ test_priority_fifo (void)
         printf ("\n");
       d->iterations++;
     }
+  free (buffer);
 }
 
 static void 
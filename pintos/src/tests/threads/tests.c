@@ -1,7 +1,11 @@
 #include "tests/threads/tests.h"
 #include <debug.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
 
 struct test 
   {
@@ -38,10 +42,17 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"thread-spawn", test_thread_spawn},
   };
 
 static const char *test_name;
 
+/* Number of milliseconds that run_batch() waits for the threads
+   that a test leaves behind to exit. */
+#define BATCH_WAIT_MS 10000
+
+static bool batch_match (const char *name, const char *patterns);
+
 /* Runs the test named NAME. */
 void
 run_test (const char *name) 
@@ -60,6 +71,74 @@ run_test (const char *name)
   PANIC ("no test named \"%s\"", name);
 }
 
+/* Runs, one after another, each test that SPEC names, without
+   rebooting in between.  SPEC has the form PATTERNS[:SKIP], where
+   PATTERNS is a comma-separated list of test names, any of which
+   may instead be a prefix of names followed by `*'.  The tests run
+   in the order of the table above, except that the first SKIP of
+   them are skipped: utils/pintos uses that to resume a batch after
+   a test brings the kernel down.
+
+   The output of each test is framed the same way as for the "run"
+   action, so that it can be split up and checked as if each test
+   had run in a boot of its own.  Before a test counts as complete,
+   the threads it started must exit, and then the scheduler and
+   page allocator are reset with thread_reset().  A test that
+   leaves pages allocated fails, so that a leak is charged to the
+   test that caused it and not to those after it. */
+void
+run_batch (const char *spec)
+{
+  const char *skip = strchr (spec, ':');
+  int skip_cnt = skip != NULL ? atoi (skip + 1) : 0;
+  int test_cnt = 0;
+  const struct test *t;
+
+  for (t = tests; t < tests + sizeof tests / sizeof *tests; t++)
+    if (batch_match (t->name, spec) && skip_cnt-- <= 0)
+      {
+        size_t free_cnt;
+        int wait_ms;
+
+        thread_reset ();
+        free_cnt = palloc_free_cnt ();
+        printf ("Executing '%s':\n", t->name);
+        run_test (t->name);
+        for (wait_ms = 0; thread_reset () > 0; wait_ms += 10)
+          {
+            if (wait_ms >= BATCH_WAIT_MS)
+              PANIC ("threads started by %s did not exit", t->name);
+            timer_msleep (10);
+          }
+        if (palloc_free_cnt () < free_cnt)
+          fail ("%zu pages still allocated after the test",
+                free_cnt - palloc_free_cnt ());
+        printf ("Execution of '%s' complete.\n", t->name);
+        test_cnt++;
+      }
+  printf ("Batch complete: %d tests.\n", test_cnt);
+}
+
+/* Returns true if NAME matches one of the comma-separated
+   PATTERNS, which end at a null character or a colon. */
+static bool
+batch_match (const char *name, const char *patterns)
+{
+  for (;;)
+    {
+      size_t len = strcspn (patterns, ",:");
+      bool prefix = len > 0 && patterns[len - 1] == '*';
+      size_t cmp_len = prefix ? len - 1 : len;
+
+      if ((prefix ? strlen (name) >= cmp_len : strlen (name) == cmp_len)
+          && !memcmp (name, patterns, cmp_len))
+        return true;
+      if (patterns[len] != ',')
+        return false;
+      patterns += len + 1;
+    }
+}
+
 /* Prints FORMAT as if with printf(),
    prefixing the output by the name of the test
    and following it with a new-line character. */
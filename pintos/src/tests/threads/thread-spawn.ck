@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+fail "Wrong output.\n"
+  if @output != 3
+     || $output[0] ne "(thread-spawn) begin"
+     || $output[1] !~ /^\(thread-spawn\) Created and joined 10000 threads in \d+ ticks\.$/
+     || $output[2] ne "(thread-spawn) end";
+pass;
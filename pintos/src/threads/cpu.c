@@ -0,0 +1,374 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include <packed.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/profile.h"
+#include "threads/trace.h"
+#include "threads/pte.h"
+#include "threads/spinlock.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#endif
+
+/* All the CPUs, of which the first CPU_CNT are in use. */
+struct cpu cpus[CPU_MAX];
+int cpu_cnt;
+
+/* The big kernel lock.  See cpu.h for details. */
+static struct spinlock kernel_lock;
+
+/* MP floating pointer structure, which the BIOS puts in one of a
+   few places in low memory to tell us where to find the MP
+   configuration table.  See [MP] 4.1 "MP Floating Pointer
+   Structure". */
+struct mp_fps
+  {
+    char signature[4];          /* "_MP_". */
+    uint32_t config;            /* Physical address of mp_config. */
+    uint8_t length;             /* Size in 16-byte paragraphs. */
+    uint8_t spec_rev;           /* MP specification version. */
+    uint8_t checksum;           /* All bytes add up to 0. */
+    uint8_t type;               /* Default configuration, if nonzero. */
+    uint8_t features[4];
+  }
+PACKED;
+
+/* MP configuration table header.  See [MP] 4.2 "MP Configuration
+   Table Header". */
+struct mp_config
+  {
+    char signature[4];          /* "PCMP". */
+    uint16_t length;            /* Size of header plus entries. */
+    uint8_t spec_rev;           /* MP specification version. */
+    uint8_t checksum;           /* All bytes add up to 0. */
+    char oem_id[8];
+    char product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t entry_cnt;         /* Number of entries that follow. */
+    uint32_t lapic_addr;        /* Physical address of local APICs. */
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+  }
+PACKED;
+
+/* MP configuration table processor entry.  Other types of entry
+   are 8 bytes long.  See [MP] 4.3.1 "Processor Entries". */
+struct mp_processor
+  {
+    uint8_t type;               /* MP_PROCESSOR. */
+    uint8_t apic_id;            /* Local APIC ID. */
+    uint8_t apic_version;
+    uint8_t flags;              /* MP_ENABLED, MP_BSP. */
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+  }
+PACKED;
+
+#define MP_PROCESSOR 0          /* mp_processor entry type. */
+#define MP_ENABLED 0x01         /* Processor is usable. */
+#define MP_BSP 0x02             /* Processor is the bootstrap processor. */
+
+void ap_main (void) NO_RETURN;
+static uintptr_t mp_probe (void);
+static struct mp_fps *mp_search (uintptr_t paddr, size_t size);
+static bool checksum_ok (const void *, size_t);
+
+/* Initializes the CPU table for a uniprocessor and the kernel
+   lock.  Called from thread_init(), before anything else can use
+   the current CPU. */
+void
+cpu_init (void)
+{
+  int i;
+
+  for (i = 0; i < CPU_MAX; i++)
+    cpus[i].id = i;
+  cpu_cnt = 1;
+  spinlock_init (&kernel_lock);
+}
+
+/* Returns true if the CPU supports all of FEATURES, a set of
+   CPUID_* flags, false otherwise.  All CPUs are assumed to be
+   alike. */
+bool
+cpu_has_feature (uint32_t features)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return (edx & features) == features;
+}
+
+/* Looks for other CPUs in the BIOS's MP configuration table and,
+   if there are any, starts them up.  Each of them runs its idle
+   thread until it finds a thread to steal from another CPU's run
+   queue (see thread.c).  Must be called by the bootstrap
+   processor with interrupts on, after the timer is calibrated
+   and before any user process starts. */
+void
+cpu_start_aps (void)
+{
+  extern uint8_t ap_start[], ap_start_end[];
+  extern uint32_t ap_cr3, ap_cr4, ap_esp;
+  uint8_t *code = ptov (LOADER_AP_BASE);
+  uint32_t *low_pt, *kernel_pt;
+  uintptr_t lapic_addr;
+  uint32_t cr4;
+  int i;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  lapic_addr = mp_probe ();
+  if (lapic_addr == 0)
+    return;
+  lapic_init (lapic_addr);
+  ASSERT (lapic_id () == cpus[0].apic_id);
+
+  /* Copy the startup code to low memory, with the page directory
+     and CR4 paging flags that the other CPUs should use. */
+  memcpy (code, ap_start, ap_start_end - ap_start);
+  *(uint32_t *) (code + ((uint8_t *) &ap_cr3 - ap_start))
+    = vtop (init_page_dir);
+  asm ("movl %%cr4, %0" : "=r" (cr4));
+  *(uint32_t *) (code + ((uint8_t *) &ap_cr4 - ap_start)) = cr4;
+
+  /* While the other CPUs start up, also map the first 4 MB of
+     physical memory at virtual address 0, as ap-start.S
+     requires.  Use a copy of the kernel's page table without
+     global bits, so that no CPU keeps any of these mappings in
+     its TLB after we remove them. */
+  low_pt = palloc_get_page (PAL_ASSERT);
+  kernel_pt = pde_get_pt (init_page_dir[pd_no (PHYS_BASE)]);
+  for (i = 0; i < (int) (PGSIZE / sizeof *low_pt); i++)
+    low_pt[i] = kernel_pt[i] & ~PTE_G;
+  init_page_dir[0] = pde_create (low_pt);
+
+  for (i = 1; i < cpu_cnt; i++)
+    {
+      struct cpu *c = &cpus[i];
+      int64_t start;
+
+      profile_init_cpu (c);
+      trace_init_cpu (c);
+      *(void **) (code + ((uint8_t *) &ap_esp - ap_start))
+        = thread_init_ap (c);
+      lapic_start_ap (c->apic_id, LOADER_AP_BASE);
+
+      start = timer_ticks ();
+      while (!c->started && timer_elapsed (start) < TIMER_FREQ)
+        barrier ();
+      if (!c->started)
+        {
+          printf ("CPU %d (APIC ID %d) did not start.\n",
+                  c->id, c->apic_id);
+          cpu_cnt = i;
+          break;
+        }
+    }
+
+  init_page_dir[0] = 0;
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)) : "memory");
+  palloc_free_page (low_pt);
+
+  printf ("Multiprocessor: %d CPUs.\n", cpu_cnt);
+}
+
+/* Returns the CPU that is running the caller.  Interrupts must
+   be off, because otherwise the caller could move to another
+   CPU by the time it uses the result. */
+struct cpu *
+cpu_current (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* With only one CPU, the answer is easy, and it is available
+     even before thread_init() sets up the running thread. */
+  if (cpu_cnt <= 1)
+    return &cpus[0];
+  return thread_current ()->cpu;
+}
+
+/* If C is another CPU and is halted, interrupts it so that it
+   checks for threads to run. */
+void
+cpu_wake (struct cpu *c)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (cpu_cnt > 1 && c->halted && c != cpu_current ())
+    lapic_send_ipi (c->apic_id, LAPIC_VEC_WAKEUP);
+}
+
+/* Wakes up one halted CPU other than the current one, if there
+   is any, so that it can steal a thread from the current CPU's
+   run queue. */
+void
+cpu_wake_any (void)
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (i = 0; i < cpu_cnt; i++)
+    if (cpus[i].halted && &cpus[i] != cpu_current ())
+      {
+        cpu_wake (&cpus[i]);
+        break;
+      }
+}
+
+/* Acquires the kernel lock for the current CPU, waiting for
+   another CPU to release it if necessary.  Interrupts must be
+   off. */
+void
+kernel_lock_acquire (void)
+{
+  spinlock_acquire (&kernel_lock);
+}
+
+/* Releases the kernel lock, which the current CPU must hold.
+   Interrupts must be off. */
+void
+kernel_lock_release (void)
+{
+  spinlock_release (&kernel_lock);
+}
+
+/* Returns true if the current CPU holds the kernel lock, false
+   otherwise.  Interrupts must be off. */
+bool
+kernel_lock_held (void)
+{
+  return spinlock_held_by_current_cpu (&kernel_lock);
+}
+
+/* If another CPU is waiting for the kernel lock, which the
+   current CPU must hold, lets it have the lock and then waits to
+   get it back.  Interrupts must be off. */
+void
+kernel_lock_relax (void)
+{
+  ASSERT (kernel_lock_held ());
+
+  if (spinlock_contended (&kernel_lock))
+    {
+      spinlock_release (&kernel_lock);
+      spinlock_acquire (&kernel_lock);
+    }
+}
+
+/* Main program of application processors, called by ap-start.S
+   on the stack of the CPU's idle thread with interrupts off. */
+void
+ap_main (void)
+{
+  struct cpu *c = cpu_current ();
+
+  intr_init_ap ();
+#ifdef USERPROG
+  gdt_init_ap ();
+#endif
+  lapic_init_ap ();
+  ASSERT (lapic_id () == c->apic_id);
+
+  c->started = true;
+  thread_start_ap ();
+}
+
+/* Finds the MP configuration table and records its enabled
+   processors in cpus[], with the bootstrap processor first, and
+   sets cpu_cnt.  Returns the physical address of the local APIC
+   registers if there is more than one usable CPU, otherwise 0. */
+static uintptr_t
+mp_probe (void)
+{
+  struct mp_fps *fps;
+  struct mp_config *config;
+  uint8_t *p, *end;
+  uintptr_t ram_end = init_ram_pages * PGSIZE;
+  int i;
+
+  if (!cpu_has_feature (CPUID_APIC))
+    return 0;
+
+  /* Search the first kB of the extended BIOS data area, the last
+     kB of base memory, and the BIOS ROM, in that order.  See [MP]
+     4 "MP Configuration Table". */
+  fps = mp_search ((uintptr_t) *(uint16_t *) ptov (0x40e) << 4, 1024);
+  if (fps == NULL)
+    fps = mp_search (((uintptr_t) *(uint16_t *) ptov (0x413) - 1) * 1024,
+                     1024);
+  if (fps == NULL)
+    fps = mp_search (0xf0000, 0x10000);
+  if (fps == NULL || fps->config == 0 || fps->config >= ram_end)
+    return 0;
+
+  config = ptov (fps->config);
+  if (memcmp (config->signature, "PCMP", 4)
+      || fps->config + config->length > ram_end
+      || !checksum_ok (config, config->length))
+    return 0;
+
+  p = (uint8_t *) (config + 1);
+  end = (uint8_t *) config + config->length;
+  cpu_cnt = 1;
+  for (i = 0; i < config->entry_cnt && p < end; i++)
+    if (*p == MP_PROCESSOR)
+      {
+        struct mp_processor *proc = (struct mp_processor *) p;
+        if (proc->flags & MP_BSP)
+          cpus[0].apic_id = proc->apic_id;
+        else if ((proc->flags & MP_ENABLED) && cpu_cnt < CPU_MAX)
+          cpus[cpu_cnt++].apic_id = proc->apic_id;
+        p += sizeof *proc;
+      }
+    else
+      p += 8;
+
+  return cpu_cnt > 1 ? config->lapic_addr : 0;
+}
+
+/* Searches for an MP floating pointer structure in the SIZE
+   bytes of physical memory starting at PADDR.  Returns the
+   structure if found, otherwise a null pointer. */
+static struct mp_fps *
+mp_search (uintptr_t paddr, size_t size)
+{
+  uint8_t *p, *end;
+
+  if (paddr == 0 || paddr + size > 0x100000)
+    return NULL;
+
+  end = (uint8_t *) ptov (paddr) + size;
+  for (p = ptov (paddr); p + sizeof (struct mp_fps) <= end; p += 16)
+    if (!memcmp (p, "_MP_", 4) && checksum_ok (p, sizeof (struct mp_fps)))
+      return (struct mp_fps *) p;
+  return NULL;
+}
+
+/* Returns true if the SIZE bytes at P add up to 0 modulo 256,
+   false otherwise. */
+static bool
+checksum_ok (const void *p_, size_t size)
+{
+  const uint8_t *p = p_;
+  uint8_t sum = 0;
+
+  while (size-- > 0)
+    sum += *p++;
+  return sum == 0;
+}
+
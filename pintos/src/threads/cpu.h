@@ -0,0 +1,70 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Maximum number of CPUs that we will use. */
+#define CPU_MAX 8
+
+/* CPU feature flags, as returned in EDX by CPUID with EAX = 1.
+   See [IA32-v2a] "CPUID". */
+#define CPUID_PSE  (1 << 3)     /* 4 MB pages. */
+#define CPUID_APIC (1 << 9)     /* Local APIC. */
+#define CPUID_PGE  (1 << 13)    /* Global pages. */
+
+/* A CPU.
+
+   Each CPU runs one thread at a time, chosen from its own run
+   queue, and keeps its own interrupt and time-slice state.  The
+   running thread's `cpu' member points to the CPU it is running
+   on (see thread.h), which is how code finds the current CPU.
+
+   CPU 0 is the bootstrap processor (BSP), the one that runs the
+   BIOS, the loader, and main().  The others, if any, are
+   application processors (APs) started by cpu_start_aps(). */
+struct cpu
+  {
+    int id;                     /* Index in cpus[]. */
+    uint8_t apic_id;            /* Local APIC ID. */
+    volatile bool started;      /* Has this CPU finished starting up? */
+    volatile bool halted;       /* Is this CPU waiting in `hlt'? */
+
+    /* Owned by thread.c. */
+    struct thread *idle_thread; /* Runs when the run queue is empty. */
+    struct list ready_list;     /* Threads ready to run on this CPU. */
+    unsigned thread_ticks;      /* # of timer ticks since last yield. */
+
+    /* Owned by interrupt.c. */
+    bool in_external_intr;      /* Processing an external interrupt? */
+    bool yield_on_return;       /* Should we yield on interrupt return? */
+  };
+
+/* All the CPUs, of which the first CPU_CNT are in use. */
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+
+void cpu_init (void);
+bool cpu_has_feature (uint32_t);
+void cpu_start_aps (void);
+struct cpu *cpu_current (void);
+void cpu_wake (struct cpu *);
+void cpu_wake_any (void);
+
+/* The "big kernel lock".
+
+   Pintos was written for a single CPU, on which turning off
+   interrupts is enough to keep other code from running.  With
+   more than one CPU, we keep that guarantee by allowing only the
+   CPU that holds this lock to run kernel code.  A CPU drops the
+   lock only when it returns to user mode, when it halts in its
+   idle thread, and briefly in thread_yield() to let waiting CPUs
+   in; it takes the lock again on the next interrupt.  Thus, user
+   programs run in parallel but the kernel does not. */
+void kernel_lock_acquire (void);
+void kernel_lock_release (void);
+bool kernel_lock_held (void);
+void kernel_lock_relax (void);
+
+#endif /* threads/cpu.h */
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "devices/ide.h"
 #include "devices/kbd.h"
 #include "devices/input.h"
 #include "devices/serial.h"
@@ -15,13 +16,16 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -33,14 +37,20 @@
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
-#include "devices/ide.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/swap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/* Flags in control register 4. */
+#define CR4_PSE 0x00000010      /* Page Size Extensions (4 MB pages). */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -57,13 +67,35 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -loops: Timer calibration from an earlier boot, in loops per
+   second, or 0 to calibrate. */
+static uint64_t timer_loops;
+
+/* -snapshot: Have the simulator save a snapshot once the timer
+   is calibrated and the CPUs are started? */
+static bool take_snapshot;
+
+/* Time taken by each phase of booting after the timer starts,
+   reported just before "Boot complete.". */
+struct boot_phase
+  {
+    const char *name;           /* Phase name. */
+    int64_t ticks;              /* Timer ticks spent in the phase. */
+  };
+static struct boot_phase boot_phases[8];
+static size_t boot_phase_cnt;
+static int64_t boot_phase_start;
+
 static void bss_init (void);
 static void paging_init (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
+static char **snapshot (void);
 static void run_actions (char **argv);
 static void usage (void);
+static void end_boot_phase (const char *name);
+static void print_boot_phases (void);
 
 #ifdef FILESYS
 static void locate_block_devices (void);
@@ -98,6 +130,8 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  profile_init ();
+  trace_init ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -118,15 +152,41 @@ main (void)
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
   serial_init_queue ();
-  timer_calibrate ();
+  boot_phase_start = timer_ticks ();
+  if (timer_loops != 0)
+    timer_set_calibration (timer_loops);
+  else
+    timer_calibrate ();
+  end_boot_phase ("timer");
+
+  /* Start any other CPUs. */
+  cpu_start_aps ();
+  end_boot_phase ("cpus");
+
+  /* Runs restored from a snapshot start here. */
+  if (take_snapshot)
+    argv = snapshot ();
 
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
   locate_block_devices ();
+  end_boot_phase ("disks");
   filesys_init (format_filesys);
+  end_boot_phase ("filesys");
+#ifdef VM
+  swap_init ();
+#endif
+#else
+  /* The tracer saves its trace to the scratch disk. */
+  if (trace_enabled)
+    {
+      ide_init ();
+      end_boot_phase ("disks");
+    }
 #endif
 
+  print_boot_phases ();
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -153,14 +213,38 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports 4 MB pages, each 4 MB of RAM that does not
+   overlap the kernel's code is mapped by a single PDE, which
+   saves a page table and takes one TLB entry instead of 1,024.
+   The kernel's code stays in 4 kB pages so that it can be
+   read-only.  If the CPU supports global pages, all of these
+   mappings are global, so that they stay in the TLB across
+   pagedir_activate(). */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
+  uint32_t cr4, global;
+  bool large;
   size_t page;
   extern char _start, _end_kernel_text;
 
+  /* Enable 4 MB pages and global pages, if available.  See
+     [IA32-v3a] 2.5 "Control Registers". */
+  asm ("movl %%cr4, %0" : "=r" (cr4));
+  large = cpu_has_feature (CPUID_PSE);
+  if (large)
+    cr4 |= CR4_PSE;
+  global = 0;
+  if (cpu_has_feature (CPUID_PGE))
+    {
+      cr4 |= CR4_PGE;
+      global = PTE_G;
+    }
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4));
+
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
@@ -171,13 +255,22 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (large && pte_idx == 0
+          && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_large (paddr) | global;
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
     }
 
   /* Store the physical address of the page directory into CR3
@@ -254,8 +347,17 @@ parse_options (char **argv)
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
+      else if (!strcmp (name, "-loops"))
+        for (timer_loops = 0; *value >= '0' && *value <= '9'; value++)
+          timer_loops = timer_loops * 10 + (*value - '0');
+      else if (!strcmp (name, "-snapshot"))
+        take_snapshot = true;
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-profile"))
+        profile_configure (value != NULL ? atoi (value) : 0);
+      else if (!strcmp (name, "-trace"))
+        trace_configure (value != NULL ? atoi (value) : 0);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -277,6 +379,40 @@ parse_options (char **argv)
   return argv;
 }
 
+/* Asks the simulator to save the state of the machine in a
+   snapshot and exit.  Later runs can restore the snapshot instead
+   of booting and calibrating the timer all over again.  The pintos
+   script's --snapshot option does this with a Bochs that has
+   misc/bochs-2.6-snapshot.patch applied.
+
+   A restored run returns from this function.  By then the pintos
+   script has replaced our command line, in low memory where the
+   loader left it, with the one for the run, so we parse it again
+   and return the actions to run. */
+static char **
+snapshot (void)
+{
+  const char s[] = "Snapshot";
+  const char *p;
+  char **argv;
+
+  printf ("Saving snapshot...\n");
+  serial_flush ();
+  for (p = s; *p != '\0'; p++)
+    outb (0x8901, *p);
+
+  /* We are now in a restored run, which should greet the user
+     like any other. */
+  printf ("Pintos booting with %'"PRIu32" kB RAM... (from snapshot)\n",
+          init_ram_pages * PGSIZE / 1024);
+  take_snapshot = false;
+  argv = read_command_line ();
+  argv = parse_options (argv);
+  if (take_snapshot)
+    PANIC ("simulator cannot take snapshots");
+  return argv;
+}
+
 /* Runs the task specified in ARGV[1]. */
 static void
 run_task (char **argv)
@@ -292,6 +428,15 @@ run_task (char **argv)
   printf ("Execution of '%s' complete.\n", task);
 }
 
+#ifndef USERPROG
+/* Runs the batch of tests specified in ARGV[1]. */
+static void
+run_batch_task (char **argv)
+{
+  run_batch (argv[1]);
+}
+#endif
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -309,6 +454,9 @@ run_actions (char **argv)
   static const struct action actions[] = 
     {
       {"run", 2, run_task},
+#ifndef USERPROG
+      {"batch", 2, run_batch_task},
+#endif
 #ifdef FILESYS
       {"ls", 1, fsutil_ls},
       {"cat", 2, fsutil_cat},
@@ -356,6 +504,7 @@ usage (void)
           "  run 'PROG [ARG...]' Run PROG and wait for it to complete.\n"
 #else
           "  run TEST           Run TEST.\n"
+          "  batch TEST,...     Run TESTs in turn (TEST may be PREFIX*).\n"
 #endif
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
@@ -378,7 +527,11 @@ usage (void)
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
+          "  -loops=N           Skip timer calibration, assuming N loops/s.\n"
+          "  -snapshot          Save a snapshot for later runs to start from.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -profile[=HZ]      Profile the kernel, sampling at HZ.\n"
+          "  -trace[=PAGES]     Trace kernel events into PAGES pages per CPU.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -386,6 +539,36 @@ usage (void)
   shutdown_power_off ();
 }
 
+/* Records that the boot phase NAME, which started where the
+   previous one left off, is over. */
+static void
+end_boot_phase (const char *name)
+{
+  int64_t now = timer_ticks ();
+
+  ASSERT (boot_phase_cnt < sizeof boot_phases / sizeof *boot_phases);
+  boot_phases[boot_phase_cnt].name = name;
+  boot_phases[boot_phase_cnt].ticks = now - boot_phase_start;
+  boot_phase_cnt++;
+  boot_phase_start = now;
+}
+
+/* Prints the time taken by each boot phase. */
+static void
+print_boot_phases (void)
+{
+  int64_t total = 0;
+  size_t i;
+
+  printf ("Boot phases:");
+  for (i = 0; i < boot_phase_cnt; i++)
+    {
+      printf (" %s %"PRId64",", boot_phases[i].name, boot_phases[i].ticks);
+      total += boot_phases[i].ticks;
+    }
+  printf (" total %"PRId64" ticks.\n", total);
+}
+
 #ifdef FILESYS
 /* Figure out what block devices to cast in the various Pintos roles. */
 static void
@@ -3,12 +3,19 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/process.h"
+#endif
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -43,13 +50,19 @@ static unsigned int unexpected_cnt[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.
+
+   The 8259A PICs deliver external interrupts 0x20...0x2f, to the
+   bootstrap processor only.  On a multiprocessor, each CPU's
+   local APIC also delivers external interrupts to it, with
+   vectors from LAPIC_VEC_TIMER up to LAPIC_VEC_SPURIOUS.  The
+   state of external interrupt processing is kept separately for
+   each CPU, in its `struct cpu'. */
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
+static bool is_external (uint8_t vec_no);
 
 /* Interrupt Descriptor Table helpers. */
 static uint64_t make_intr_gate (void (*) (void), int dpl);
@@ -117,7 +130,6 @@ intr_disable (void)
 void
 intr_init (void)
 {
-  uint64_t idtr_operand;
   int i;
 
   /* Initialize interrupt controller. */
@@ -126,12 +138,7 @@ intr_init (void)
   /* Initialize IDT. */
   for (i = 0; i < INTR_CNT; i++)
     idt[i] = make_intr_gate (intr_stubs[i], 0);
-
-  /* Load IDT register.
-     See [IA32-v2a] "LIDT" and [IA32-v3a] 5.10 "Interrupt
-     Descriptor Table (IDT)". */
-  idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
-  asm volatile ("lidt %0" : : "m" (idtr_operand));
+  intr_init_ap ();
 
   /* Initialize intr_names. */
   for (i = 0; i < INTR_CNT; i++)
@@ -157,6 +164,20 @@ intr_init (void)
   intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Points the calling CPU to the IDT, which all CPUs share.
+   intr_init() does this for the bootstrap processor. */
+void
+intr_init_ap (void)
+{
+  uint64_t idtr_operand;
+
+  /* Load IDT register.
+     See [IA32-v2a] "LIDT" and [IA32-v3a] 5.10 "Interrupt
+     Descriptor Table (IDT)". */
+  idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
+  asm volatile ("lidt %0" : : "m" (idtr_operand));
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -181,7 +202,7 @@ void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
                    const char *name) 
 {
-  ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+  ASSERT (is_external (vec_no));
   register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -202,7 +223,7 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
                    intr_handler_func *handler, const char *name)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (!is_external (vec_no));
   register_handler (vec_no, dpl, level, handler, name);
 }
 
@@ -211,7 +232,13 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 bool
 intr_context (void) 
 {
-  return in_external_intr;
+  /* External interrupts are processed with interrupts off, so
+     with interrupts on the current CPU cannot be processing one.
+     This also keeps us from looking at the wrong CPU's state if
+     we move to another CPU. */
+  if (intr_get_level () == INTR_ON)
+    return false;
+  return cpu_current ()->in_external_intr;
 }
 
 /* During processing of an external interrupt, directs the
@@ -222,7 +249,16 @@ void
 intr_yield_on_return (void) 
 {
   ASSERT (intr_context ());
-  yield_on_return = true;
+  cpu_current ()->yield_on_return = true;
+}
+
+/* Returns true if VEC_NO is an external interrupt vector, false
+   otherwise. */
+static bool
+is_external (uint8_t vec_no)
+{
+  return ((vec_no >= 0x20 && vec_no < 0x30)
+          || (vec_no >= LAPIC_VEC_TIMER && vec_no < LAPIC_VEC_SPURIOUS));
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -345,27 +381,42 @@ void
 intr_handler (struct intr_frame *frame) 
 {
   bool external;
+  bool locked;
+  enum intr_level old_level;
   intr_handler_func *handler;
+  struct cpu *c;
+
+  /* Code running in user mode, and an idle CPU waiting for an
+     interrupt, do not hold the kernel lock (see cpu.h).  Take it
+     until we return. */
+  old_level = intr_disable ();
+  locked = kernel_lock_held ();
+  if (!locked)
+    kernel_lock_acquire ();
+  intr_set_level (old_level);
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
-     and they need to be acknowledged on the PIC (see below).
-     An external interrupt handler cannot sleep. */
-  external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+     and they need to be acknowledged on the PIC or local APIC
+     (see below).  An external interrupt handler cannot sleep. */
+  external = is_external (frame->vec_no);
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (!intr_context ());
 
-      in_external_intr = true;
-      yield_on_return = false;
+      c = cpu_current ();
+      c->in_external_intr = true;
+      c->yield_on_return = false;
     }
 
   /* Invoke the interrupt's handler. */
+  trace (TRACE_INTR_ENTER, frame->vec_no, 0, 0);
   handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
-  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
+  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+           || frame->vec_no == LAPIC_VEC_SPURIOUS)
     {
       /* There is no handler, but this interrupt can trigger
          spuriously due to a hardware fault or hardware race
@@ -373,6 +424,7 @@ intr_handler (struct intr_frame *frame)
     }
   else
     unexpected_interrupt (frame);
+  trace (TRACE_INTR_EXIT, frame->vec_no, 0, 0);
 
   /* Complete the processing of an external interrupt. */
   if (external) 
@@ -380,12 +432,33 @@ intr_handler (struct intr_frame *frame)
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (intr_context ());
 
-      in_external_intr = false;
-      pic_end_of_interrupt (frame->vec_no); 
+      c = cpu_current ();
+      c->in_external_intr = false;
+      if (frame->vec_no < 0x30)
+        pic_end_of_interrupt (frame->vec_no); 
+      else
+        lapic_eoi ();
 
-      if (yield_on_return) 
+      if (c->yield_on_return) 
         thread_yield (); 
     }
+
+#ifdef USERPROG
+  /* A thread whose process is exiting goes no further than here
+     on its way back to user mode, whether from a system call, a
+     fault, or a timer interrupt. */
+  if (frame->cs == SEL_UCSEG)
+    process_check_dying ();
+#endif
+
+  /* Give back the kernel lock if we took it.  We may be on a
+     different CPU now, if we slept, but whichever CPU we are on
+     holds the lock. */
+  if (!locked)
+    {
+      intr_disable ();
+      kernel_lock_release ();
+    }
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
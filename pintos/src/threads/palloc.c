@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,14 +24,32 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   When a CPU has nothing else to do, its idle thread calls
+   palloc_zero_idle() to fill free pages with zeros ahead of
+   time, so that PAL_ZERO requests can usually skip the memset().
+   The idle thread works down from the top of each pool, while
+   ordinary allocations come from the bottom, so requests that do
+   not need zeroed pages tend to leave the zeroed ones alone. */
+
+/* Maximum number of free pages to keep zeroed in each pool. */
+#define ZERO_MAX 256
 
 /* A memory pool. */
 struct pool
   {
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct bitmap *zero_map;            /* Free pages known to be zero. */
     uint8_t *base;                      /* Base of pool. */
+    size_t free_cnt;                    /* Number of free pages. */
+    size_t zero_cnt;                    /* Number of true bits in zero_map. */
+    size_t zero_cursor;                 /* Where palloc_zero_idle() looks. */
+
+    /* Statistics. */
+    unsigned long long zero_requests;   /* Pages requested with PAL_ZERO. */
+    unsigned long long zero_hits;       /* ...that were already zero. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +58,9 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static bool zero_page (struct pool *);
+static void reset_pool (struct pool *);
+static void print_pool_stats (const struct pool *, const char *name);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -71,14 +93,39 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
+  uint8_t *pages;
   size_t page_idx;
+  size_t zero_cnt;
 
   if (page_cnt == 0)
     return NULL;
 
   lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  page_idx = BITMAP_ERROR;
+  if ((flags & PAL_ZERO) && page_cnt == 1)
+    {
+      /* Free pages in zero_map are never in use, so any of them
+         will do. */
+      page_idx = bitmap_scan (pool->zero_map, 0, 1, true);
+      if (page_idx != BITMAP_ERROR)
+        bitmap_mark (pool->used_map, page_idx);
+    }
+  if (page_idx == BITMAP_ERROR)
+    page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  zero_cnt = 0;
+  if (page_idx != BITMAP_ERROR)
+    {
+      /* Take the pages out of the zeroed pool.  free_cnt is also
+         updated by palloc_free_multiple(), without the lock. */
+      enum intr_level old_level;
+
+      zero_cnt = bitmap_count (pool->zero_map, page_idx, page_cnt, true);
+      bitmap_set_multiple (pool->zero_map, page_idx, page_cnt, false);
+      pool->zero_cnt -= zero_cnt;
+      old_level = intr_disable ();
+      pool->free_cnt -= page_cnt;
+      intr_set_level (old_level);
+    }
   lock_release (&pool->lock);
 
   if (page_idx != BITMAP_ERROR)
@@ -89,7 +136,12 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (pages != NULL) 
     {
       if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
+        {
+          if (zero_cnt < page_cnt)
+            memset (pages, 0, PGSIZE * page_cnt);
+          pool->zero_requests += page_cnt;
+          pool->zero_hits += zero_cnt;
+        }
     }
   else 
     {
@@ -119,6 +171,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -138,7 +191,11 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 #endif
 
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+  ASSERT (bitmap_none (pool->zero_map, page_idx, page_cnt));
+  old_level = intr_disable ();
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  pool->free_cnt += page_cnt;
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,15 +205,122 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes one free page that is not yet known to be zero, if
+   there is one and fewer than ZERO_MAX pages in its pool are
+   already zeroed.  Returns true if it zeroed a page, false if
+   there was nothing to do.
+
+   Called by the idle thread, which must not sleep, so it gives
+   up rather than waiting for a pool's lock. */
+bool
+palloc_zero_idle (void)
+{
+  return zero_page (&kernel_pool) || zero_page (&user_pool);
+}
+
+/* Returns the number of free pages in both pools. */
+size_t
+palloc_free_cnt (void)
+{
+  enum intr_level old_level = intr_disable ();
+  size_t free_cnt = kernel_pool.free_cnt + user_pool.free_cnt;
+  intr_set_level (old_level);
+
+  return free_cnt;
+}
+
+/* Forgets which free pages have been zeroed, as just after
+   boot, so that the next PAL_ZERO requests find none ready.
+   Used between the tests of a batch (see thread_reset()). */
+void
+palloc_reset (void)
+{
+  reset_pool (&kernel_pool);
+  reset_pool (&user_pool);
+}
+
+/* Prints statistics about the zeroed page pools. */
+void
+palloc_print_stats (void)
+{
+  print_pool_stats (&kernel_pool, "kernel");
+  print_pool_stats (&user_pool, "user");
+}
+
+/* Zeroes a page in POOL for palloc_zero_idle(). */
+static bool
+zero_page (struct pool *pool)
+{
+  enum intr_level old_level;
+  size_t page_cnt = bitmap_size (pool->used_map);
+  size_t i;
+  bool zeroed = false;
+
+  if (pool->zero_cnt >= ZERO_MAX || pool->zero_cnt >= pool->free_cnt)
+    return false;
+
+  /* Keep interrupts off while we hold the lock, so that the idle
+     thread can't be preempted with it held. */
+  old_level = intr_disable ();
+  if (lock_try_acquire (&pool->lock))
+    {
+      /* Look for a free page that isn't zeroed yet, working down
+         from where we left off. */
+      for (i = 0; i < page_cnt; i++)
+        {
+          size_t idx = pool->zero_cursor;
+
+          pool->zero_cursor = (idx == 0 ? page_cnt : idx) - 1;
+          if (!bitmap_test (pool->used_map, idx)
+              && !bitmap_test (pool->zero_map, idx))
+            {
+              memset (pool->base + PGSIZE * idx, 0, PGSIZE);
+              bitmap_mark (pool->zero_map, idx);
+              pool->zero_cnt++;
+              zeroed = true;
+              break;
+            }
+        }
+      lock_release (&pool->lock);
+    }
+  intr_set_level (old_level);
+
+  return zeroed;
+}
+
+/* Forgets which of POOL's free pages are zeroed, for
+   palloc_reset(). */
+static void
+reset_pool (struct pool *pool)
+{
+  size_t page_cnt = bitmap_size (pool->used_map);
+
+  lock_acquire (&pool->lock);
+  bitmap_set_all (pool->zero_map, false);
+  pool->zero_cnt = 0;
+  pool->zero_cursor = page_cnt > 0 ? page_cnt - 1 : 0;
+  lock_release (&pool->lock);
+}
+
+/* Prints statistics about the zeroed pages in POOL, whose name
+   is NAME. */
+static void
+print_pool_stats (const struct pool *pool, const char *name)
+{
+  printf ("Palloc: %llu of %llu zeroed %s pages came from the "
+          "zeroed pool.\n", pool->zero_hits, pool->zero_requests, name);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's used_map and zero_map at its base.
+     Calculate the space needed for the bitmaps
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (2 * bm_size, PGSIZE);
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -165,8 +329,14 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->zero_map = bitmap_create_in_buf (page_cnt, (uint8_t *) base + bm_size,
+                                      bm_size);
   p->base = base + bm_pages * PGSIZE;
+  p->free_cnt = page_cnt;
+  p->zero_cnt = 0;
+  p->zero_cursor = page_cnt > 0 ? page_cnt - 1 : 0;
+  p->zero_requests = p->zero_hits = 0;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,161 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Each histogram bucket counts the samples that fell in a
+   (1 << PROFILE_SHIFT)-byte range of the kernel image. */
+#define PROFILE_SHIFT 3
+
+/* Highest sampling rate we allow, in Hz.  Every sample costs an
+   interrupt, so much more than this leaves little time for
+   anything else, especially under Bochs. */
+#define PROFILE_MAX_HZ 10000
+
+/* Profiling state for one CPU. */
+struct profile_cpu
+  {
+    unsigned *hist;             /* Histogram, or null if none. */
+    uint64_t samples;           /* Number of samples taken. */
+    uint64_t user_samples;      /* Samples outside the kernel image. */
+    unsigned intrs;             /* Interrupts since last timer tick. */
+  };
+
+static struct profile_cpu profile_cpus[CPU_MAX];
+
+/* Is profiling enabled? */
+static bool enabled;
+
+/* Timer interrupts per timer tick.  Normally 1, but more when
+   the profiler asks for more than TIMER_FREQ samples per
+   second. */
+static unsigned intrs_per_tick = 1;
+
+/* Start and end of the range of kernel addresses that the
+   histograms cover: the kernel's code and read-only data. */
+static uintptr_t text_start, text_end;
+
+/* Enables profiling at approximately HZ samples per second on
+   each CPU, or at TIMER_FREQ if HZ is 0.  Must be called before
+   timer_init(), from the -profile kernel option.
+
+   Rates above TIMER_FREQ are rounded down to a multiple of
+   TIMER_FREQ and make the 8254 (and the local APIC timers)
+   interrupt that much faster, with only one interrupt out of
+   every HZ / TIMER_FREQ counting as a timer tick. */
+void
+profile_configure (int hz)
+{
+  if (hz > PROFILE_MAX_HZ)
+    hz = PROFILE_MAX_HZ;
+  intrs_per_tick = hz > TIMER_FREQ ? hz / TIMER_FREQ : 1;
+  enabled = true;
+}
+
+/* Returns the number of timer interrupts per timer tick. */
+unsigned
+profile_intrs_per_tick (void)
+{
+  return intrs_per_tick;
+}
+
+/* Allocates the bootstrap processor's histogram, if profiling
+   is enabled.  Must be called after palloc_init(). */
+void
+profile_init (void)
+{
+  extern char _start, _end_kernel_text;
+
+  if (!enabled)
+    return;
+
+  text_start = (uintptr_t) &_start;
+  text_end = (uintptr_t) &_end_kernel_text;
+  profile_init_cpu (&cpus[0]);
+}
+
+/* Allocates the histogram for CPU C, if profiling is enabled.
+   Called for each application processor before it starts. */
+void
+profile_init_cpu (struct cpu *c)
+{
+  size_t bucket_cnt, page_cnt;
+  unsigned *hist;
+
+  if (!enabled)
+    return;
+
+  bucket_cnt = (text_end - text_start) >> PROFILE_SHIFT;
+  page_cnt = DIV_ROUND_UP (bucket_cnt * sizeof *hist, PGSIZE);
+  hist = palloc_get_multiple (PAL_ZERO, page_cnt);
+  if (hist == NULL)
+    printf ("Profile: out of memory, not profiling CPU %d.\n", c->id);
+  profile_cpus[c->id].hist = hist;
+}
+
+/* Called on every timer interrupt, with F as the interrupted
+   frame.  Records a sample if profiling is enabled.  Returns
+   true if this interrupt also counts as a timer tick, false if
+   it was only for taking a sample. */
+bool
+profile_timer_interrupt (const struct intr_frame *f)
+{
+  struct profile_cpu *p;
+  uintptr_t eip;
+
+  if (!enabled)
+    return true;
+
+  p = &profile_cpus[cpu_current ()->id];
+  if (p->hist != NULL)
+    {
+      eip = (uintptr_t) f->eip;
+      if (eip >= text_start && eip < text_end)
+        p->hist[(eip - text_start) >> PROFILE_SHIFT]++;
+      else
+        p->user_samples++;
+      p->samples++;
+    }
+
+  if (++p->intrs < intrs_per_tick)
+    return false;
+  p->intrs = 0;
+  return true;
+}
+
+/* Prints the profile, if profiling is enabled, as a summary
+   followed by one "prof CPU ADDRESS COUNT" line for each
+   nonempty histogram bucket.  utils/pintos-profile reads these
+   lines. */
+void
+profile_print_stats (void)
+{
+  int i;
+
+  if (!enabled)
+    return;
+
+  printf ("Profile: %u Hz, %d bytes per bucket.\n",
+          TIMER_FREQ * intrs_per_tick, 1 << PROFILE_SHIFT);
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      struct profile_cpu *p = &profile_cpus[i];
+      size_t bucket;
+
+      printf ("Profile: CPU %d: %"PRIu64" samples, %"PRIu64" in user "
+              "mode.\n", i, p->samples, p->user_samples);
+      if (p->hist == NULL)
+        continue;
+      for (bucket = 0; bucket < (text_end - text_start) >> PROFILE_SHIFT;
+           bucket++)
+        if (p->hist[bucket] != 0)
+          printf ("prof %d %#"PRIxPTR" %u\n", i,
+                  text_start + (bucket << PROFILE_SHIFT), p->hist[bucket]);
+    }
+}
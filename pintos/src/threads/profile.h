@@ -0,0 +1,24 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+/* Sampling kernel profiler.
+
+   When enabled with the -profile kernel option, every timer
+   interrupt records the address of the instruction that it
+   interrupted in a histogram kept by the CPU that took the
+   interrupt.  The histograms are printed at power off, and
+   utils/pintos-profile turns them into a flat profile. */
+
+struct cpu;
+struct intr_frame;
+
+void profile_configure (int hz);
+unsigned profile_intrs_per_tick (void);
+void profile_init (void);
+void profile_init_cpu (struct cpu *);
+bool profile_timer_interrupt (const struct intr_frame *);
+void profile_print_stats (void);
+
+#endif /* threads/profile.h */
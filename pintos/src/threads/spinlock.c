@@ -0,0 +1,80 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <stddef.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+/* Initializes LOCK.  A spinlock is free after initialization. */
+void
+spinlock_init (struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+
+  lock->next = lock->owner = 0;
+  lock->holder = NULL;
+}
+
+/* Acquires LOCK, spinning until it becomes available if
+   necessary.  The lock must not already be held by the current
+   CPU.
+
+   This function must be called with interrupts turned off. */
+void
+spinlock_acquire (struct spinlock *lock)
+{
+  uint32_t ticket = 1;
+
+  ASSERT (lock != NULL);
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!spinlock_held_by_current_cpu (lock));
+
+  /* Take a ticket.  The `lock' prefix makes the increment atomic
+     with respect to other CPUs.  See [IA32-v2b] "XADD". */
+  asm volatile ("lock xaddl %0, %1"
+                : "+r" (ticket), "+m" (lock->next) : : "memory");
+
+  /* Wait for our turn.  See [IA32-v2b] "PAUSE". */
+  while (lock->owner != ticket)
+    asm volatile ("pause" : : : "memory");
+
+  lock->holder = cpu_current ();
+}
+
+/* Releases LOCK, which must be held by the current CPU. */
+void
+spinlock_release (struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+  ASSERT (spinlock_held_by_current_cpu (lock));
+
+  lock->holder = NULL;
+
+  /* Stores are not reordered with older stores on x86, so other
+     CPUs see our writes to the protected data before they see
+     the lock become free.  Only the holder writes OWNER, so the
+     increment need not be atomic. */
+  barrier ();
+  lock->owner++;
+}
+
+/* Returns true if the current CPU holds LOCK, false
+   otherwise. */
+bool
+spinlock_held_by_current_cpu (const struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+
+  return lock->holder != NULL && lock->holder == cpu_current ();
+}
+
+/* Returns true if some CPU is waiting for LOCK, false
+   otherwise.  The answer may be out of date by the time the
+   caller sees it, so it is useful only as a hint. */
+bool
+spinlock_contended (const struct spinlock *lock)
+{
+  ASSERT (lock != NULL);
+
+  return lock->next - lock->owner > 1;
+}
@@ -0,0 +1,35 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A spinlock, for mutual exclusion among CPUs.
+
+   Disabling interrupts only excludes other code on the same CPU,
+   so data shared among CPUs needs a lock that works without the
+   scheduler.  A CPU waiting for a spinlock simply loops until
+   the lock is free.
+
+   This is a "ticket lock": each CPU that wants the lock takes
+   the next ticket with an atomic increment and waits until its
+   number is served, so CPUs acquire the lock in the order that
+   they asked for it and no CPU starves.
+
+   A spinlock must be acquired with interrupts turned off,
+   because an interrupt handler that tried to acquire a lock
+   already held by the CPU it interrupted would wait forever. */
+struct spinlock
+  {
+    volatile uint32_t next;     /* Next ticket to hand out. */
+    volatile uint32_t owner;    /* Ticket being served. */
+    struct cpu *holder;         /* CPU holding the lock (for debugging). */
+  };
+
+void spinlock_init (struct spinlock *);
+void spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_held_by_current_cpu (const struct spinlock *);
+bool spinlock_contended (const struct spinlock *);
+
+#endif /* threads/spinlock.h */
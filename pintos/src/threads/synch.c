@@ -31,6 +31,7 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -75,6 +76,46 @@ sema_down (struct semaphore *sema)
   intr_set_level (old_level);
 }
 
+/* Like sema_down(), but gives up if the running thread is
+   interrupted with thread_interrupt(), before or during the
+   wait.  Returns true if SEMA was decremented, false if the
+   thread was interrupted. */
+bool
+sema_down_interruptible (struct semaphore *sema) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (sema != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  while (sema->value == 0 && !cur->interrupted) 
+    {
+      list_push_back (&sema->waiters, &cur->elem);
+      cur->interrupt_sema = sema;
+      thread_block ();
+      cur->interrupt_sema = NULL;
+    }
+  if (!cur->interrupted)
+    {
+      sema->value--;
+      success = true;
+    }
+  else
+    {
+      /* sema_up() may have picked us to wake.  Pass that on. */
+      if (sema->value > 0 && !list_empty (&sema->waiters))
+        thread_unblock (list_entry (list_pop_front (&sema->waiters),
+                                    struct thread, elem));
+      success = false;
+    }
+  intr_set_level (old_level);
+
+  return success;
+}
+
 /* Down or "P" operation on a semaphore, but only if the
    semaphore is not already 0.  Returns true if the semaphore is
    decremented, false otherwise.
@@ -196,8 +237,10 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  trace (TRACE_LOCK_ACQUIRE, (uintptr_t) lock, 0, 0);
   sema_down (&lock->semaphore);
   lock->holder = thread_current ();
+  trace (TRACE_LOCK_ACQUIRED, (uintptr_t) lock, 0, 0);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -216,7 +259,10 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      trace (TRACE_LOCK_ACQUIRED, (uintptr_t) lock, 0, 0);
+    }
   return success;
 }
 
@@ -231,6 +277,7 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  trace (TRACE_LOCK_RELEASE, (uintptr_t) lock, 0, 0);
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
@@ -301,6 +348,41 @@ cond_wait (struct condition *cond, struct lock *lock)
   lock_acquire (lock);
 }
 
+/* Like cond_wait(), but gives up if the running thread is
+   interrupted with thread_interrupt(), before or during the
+   wait.  LOCK is reacquired either way.  Returns true if COND
+   was signaled, false if the thread was interrupted. */
+bool
+cond_wait_interruptible (struct condition *cond, struct lock *lock) 
+{
+  struct semaphore_elem waiter;
+
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
+  
+  sema_init (&waiter.semaphore, 0);
+  list_push_back (&cond->waiters, &waiter.elem);
+  lock_release (lock);
+  if (sema_down_interruptible (&waiter.semaphore))
+    {
+      lock_acquire (lock);
+      return true;
+    }
+
+  /* cond_signal() removes a waiter and ups its semaphore while
+     holding LOCK, so with LOCK held again, WAITER is still on the
+     list unless it was signaled.  Pass on a signal that we won't
+     use. */
+  lock_acquire (lock);
+  if (waiter.semaphore.value == 0)
+    list_remove (&waiter.elem);
+  else
+    cond_signal (cond, lock);
+  return false;
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
    LOCK must be held before calling this function.
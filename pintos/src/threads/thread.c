@@ -4,12 +4,15 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include <threadstat.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -20,23 +23,27 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Idle thread. */
-static struct thread *idle_thread;
-
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Pages of destroyed threads, kept for reuse by thread_create()
+   so that creating a thread does not always mean going to the
+   page allocator and zeroing a whole page.  Each page still holds
+   the `struct thread' of the thread that last used it, whose tid
+   the next thread to use the page takes over: a tid is not
+   reused until its thread has been joined, so it cannot be
+   confused with a live thread.  Access with interrupts off. */
+#define THREAD_CACHE_MAX 8
+static struct thread *thread_cache[THREAD_CACHE_MAX];
+static size_t thread_cache_cnt;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -52,7 +59,6 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
@@ -62,8 +68,13 @@ bool thread_mlfqs;
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
+static void idle_loop (void) NO_RETURN;
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
+static struct thread *steal_thread (struct cpu *);
+static void thread_enqueue (struct thread *);
+static bool thread_is_mobile (struct thread *);
+static struct thread *alloc_thread (tid_t *);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
@@ -76,7 +87,8 @@ static tid_t allocate_tid (void);
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queues, the tid lock, and the CPU
+   table, and takes the kernel lock for the bootstrap processor.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -87,24 +99,30 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
+  cpu_init ();
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = 0; i < CPU_MAX; i++)
+    list_init (&cpus[i].ready_list);
   list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
+  initial_thread->cpu = &cpus[0];
   initial_thread->tid = allocate_tid ();
+  kernel_lock_acquire ();
 
   // Initialize file_desc array by 0. 
   // File descriptor can be released before exit thread.
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
-   Also creates the idle thread. */
+   Also creates the bootstrap processor's idle thread. */
 void
 thread_start (void) 
 {
@@ -126,9 +144,11 @@ void
 thread_tick (void) 
 {
   struct thread *t = thread_current ();
+  struct cpu *c = t->cpu;
 
   /* Update statistics. */
-  if (t == idle_thread)
+  t->run_ticks++;
+  if (t == c->idle_thread)
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
@@ -138,7 +158,7 @@ thread_tick (void)
     kernel_ticks++;
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (++c->thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
@@ -179,7 +199,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread (&tid);
 
   if (t == NULL)
     return TID_ERROR;
@@ -187,8 +207,8 @@ thread_create (const char *name, int priority,
   /* Initialize thread. */
   init_thread (t, name, priority);
   t->parent = thread_current ();
-  tid = t->tid = allocate_tid ();
-  
+  t->tid = tid;
+  trace_thread (tid, name);
 
   list_push_back (&thread_current()->child_list, &t->child_elem);
 
@@ -233,6 +253,7 @@ thread_block (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   thread_current ()->status = THREAD_BLOCKED;
+  trace (TRACE_BLOCK, 0, 0, 0);
   schedule ();
 }
 
@@ -253,8 +274,31 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  thread_enqueue (t);
   t->status = THREAD_READY;
+  trace (TRACE_UNBLOCK, t->tid, 0, 0);
+  intr_set_level (old_level);
+}
+
+/* Interrupts thread T: its waits in sema_down_interruptible()
+   and cond_wait_interruptible(), the one it is in now and any
+   later ones, return false at once.  Other waits are not
+   affected. */
+void
+thread_interrupt (struct thread *t)
+{
+  enum intr_level old_level;
+
+  ASSERT (is_thread (t));
+
+  old_level = intr_disable ();
+  t->interrupted = true;
+  if (t->interrupt_sema != NULL)
+    {
+      list_remove (&t->elem);
+      t->interrupt_sema = NULL;
+      thread_unblock (t);
+    }
   intr_set_level (old_level);
 }
 
@@ -299,9 +343,12 @@ thread_exit (void)
   struct thread *t = thread_current ();
   ASSERT (!intr_context ());
 
-  printf("%s: exit(%d)\n", t->name, t->exit_status);
-
 #ifdef USERPROG
+  /* Only a user process reports its exit status.  Its other
+     threads, and kernel threads, end quietly. */
+  if (t->process == t)
+    printf("%s: exit(%d)\n", t->name, t->exit_status);
+
   process_exit ();
 #endif
 
@@ -319,6 +366,120 @@ thread_exit (void)
   NOT_REACHED ();
 }
 
+/* Waits for thread TID, a child of the running thread created
+   by thread_create(), to exit, then destroys it and returns its
+   exit status.  Returns -1 immediately if TID is not a child of
+   the running thread or has already been joined. */
+int
+thread_join (tid_t tid)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&cur->child_list); e != list_end (&cur->child_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, child_elem);
+      if (t->tid == tid)
+        {
+          int status;
+
+          sema_down (&t->exit_program);
+          status = t->exit_status;
+          list_remove (&t->child_elem);
+          thread_free (t);
+          return status;
+        }
+    }
+  return -1;
+}
+
+/* Frees the page of T, a thread that has exited, once its parent
+   has no more use for it.  Keeps the page for a future
+   thread_create() if there is room. */
+void
+thread_free (struct thread *t)
+{
+  enum intr_level old_level;
+
+  ASSERT (is_thread (t));
+  ASSERT (t->status == THREAD_DYING);
+  ASSERT (t != initial_thread);
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt < THREAD_CACHE_MAX)
+    {
+      thread_cache[thread_cache_cnt++] = t;
+      t = NULL;
+    }
+  intr_set_level (old_level);
+
+  if (t != NULL)
+    palloc_free_page (t);
+}
+
+/* Frees the pages of the running thread's children that have
+   exited, which a test need not join, restores the running
+   thread's priority to PRI_DEFAULT, empties the cache of dead
+   threads' pages, makes the page allocator forget its zeroed
+   pages, and returns the number of threads other than it and the
+   idle threads that have not yet exited.  Used between the tests
+   of a batch (see run_batch() in tests/threads/tests.c), so that
+   each test starts out as if just after boot.  There is no MLFQS
+   state to reset: thread_set_nice() and the rest are not
+   implemented.  Timer ticks are not wound back, so the MLFQS
+   tests, which measure from boot, are not run in batches. */
+int
+thread_reset (void)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e, *next;
+  enum intr_level old_level;
+  int live_cnt = 0;
+
+  /* Count before reaping, so that a return value of 0 means that
+     every thread has exited and been reaped.  A thread that exited
+     between reaping and counting would be left unreaped. */
+  old_level = intr_disable ();
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      if (t != cur && (t->cpu == NULL || t != t->cpu->idle_thread))
+        live_cnt++;
+    }
+  intr_set_level (old_level);
+
+  for (e = list_begin (&cur->child_list); e != list_end (&cur->child_list);
+       e = next)
+    {
+      struct thread *t = list_entry (e, struct thread, child_elem);
+      next = list_next (e);
+      if (sema_try_down (&t->exit_program))
+        {
+          list_remove (&t->child_elem);
+          thread_free (t);
+        }
+    }
+  thread_set_priority (PRI_DEFAULT);
+
+  for (;;)
+    {
+      struct thread *t = NULL;
+
+      old_level = intr_disable ();
+      if (thread_cache_cnt > 0)
+        t = thread_cache[--thread_cache_cnt];
+      intr_set_level (old_level);
+      if (t == NULL)
+        break;
+      palloc_free_page (t);
+    }
+  palloc_reset ();
+
+  return live_cnt;
+}
+
 /* Yields the CPU.  The current thread is not put to sleep and
    may be scheduled again immediately at the scheduler's whim. */
 void
@@ -330,8 +491,9 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+  kernel_lock_relax ();
+  if (cur != cur->cpu->idle_thread) 
+    thread_enqueue (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -354,6 +516,51 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
+/* Fills in *ST with the accounting for the thread with the
+   lowest tid not less than TID, and returns that thread's tid.
+   Returns TID_ERROR if there is no such thread.  Calling this
+   with 0, then with one more than each tid it returns, visits
+   every thread. */
+tid_t
+thread_get_stats (tid_t tid, struct thread_stat *st)
+{
+  static const char states[] = {'R', 'W', 'B', 'D'};
+  struct thread *found = NULL;
+  struct list_elem *e;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      if (t->tid >= tid && (found == NULL || t->tid < found->tid))
+        found = t;
+    }
+  if (found != NULL)
+    {
+      memset (st, 0, sizeof *st);
+      st->tid = found->tid;
+      strlcpy (st->name, found->name, sizeof st->name);
+      st->state = states[found->status];
+      st->ticks = found->run_ticks;
+      st->voluntary_switches = found->voluntary_switches;
+      st->involuntary_switches = found->involuntary_switches;
+#ifdef USERPROG
+      st->page_faults = found->page_faults;
+      st->read_bytes = found->read_bytes;
+      st->write_bytes = found->write_bytes;
+      memcpy (st->syscalls, found->syscall_cnt, sizeof st->syscalls);
+#endif
+      tid = found->tid;
+    }
+  else
+    tid = TID_ERROR;
+  intr_set_level (old_level);
+
+  return tid;
+}
+
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void
 thread_set_priority (int new_priority) 
@@ -401,19 +608,34 @@ thread_get_recent_cpu (void)
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
-   The idle thread is initially put on the ready list by
-   thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   The bootstrap processor's idle thread is initially put on the
+   ready list by thread_start().  It will be scheduled once
+   initially, at which point it initializes its CPU's
+   idle_thread, "up"s the semaphore passed to it to enable
+   thread_start() to continue, and immediately blocks.  After
+   that, the idle thread never appears in the ready list.  It is
+   returned by next_thread_to_run() as a special case when the
+   ready list is empty and there is nothing to steal.
+
+   The idle threads of other CPUs are set up by thread_init_ap()
+   and start out running. */
 static void
 idle (void *idle_started_ UNUSED) 
 {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current ();
+  struct thread *cur = thread_current ();
+
+  cur->cpu->idle_thread = cur;
   sema_up (idle_started);
+  idle_loop ();
+}
+
+/* Body of each CPU's idle thread.  An idle thread only ever
+   runs on its own CPU. */
+static void
+idle_loop (void)
+{
+  struct cpu *c = thread_current ()->cpu;
 
   for (;;) 
     {
@@ -421,6 +643,25 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing else is ready, so zero a free page for later
+         PAL_ZERO allocations, then check again for other work.
+         Before checking, give other CPUs a turn at the kernel
+         lock, and take any pending interrupts, which may wake
+         threads up.  The `nop' is needed because `sti' only takes
+         effect after the instruction that follows it. */
+      if (palloc_zero_idle ())
+        {
+          kernel_lock_relax ();
+          asm volatile ("sti; nop; cli" : : : "memory");
+          continue;
+        }
+
+      /* Let other CPUs into the kernel while we wait.  The
+         interrupt that wakes us up takes the kernel lock until
+         it returns (see intr_handler()). */
+      c->halted = true;
+      kernel_lock_release ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -434,9 +675,46 @@ idle (void *idle_started_ UNUSED)
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
          7.11.1 "HLT Instruction". */
       asm volatile ("sti; hlt" : : : "memory");
+
+      intr_disable ();
+      kernel_lock_acquire ();
+      c->halted = false;
     }
 }
 
+/* Creates the idle thread of application processor C, which has
+   not started yet, and returns the stack pointer for C to start
+   up on.  Called by cpu_start_aps() on the bootstrap
+   processor. */
+void *
+thread_init_ap (struct cpu *c)
+{
+  struct thread *t;
+  char name[16];
+
+  t = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  snprintf (name, sizeof name, "idle%d", c->id);
+  init_thread (t, name, PRI_MIN);
+  t->status = THREAD_RUNNING;
+  t->tid = allocate_tid ();
+  t->cpu = c;
+  c->idle_thread = t;
+
+  return (uint8_t *) t + PGSIZE;
+}
+
+/* Turns the code running on a newly started application
+   processor into its idle thread.  Must be called with
+   interrupts off, on the stack returned by thread_init_ap(). */
+void
+thread_start_ap (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  kernel_lock_acquire ();
+  idle_loop ();
+}
+
 /* Function used as the basis for a kernel thread. */
 static void
 kernel_thread (thread_func *function, void *aux) 
@@ -469,6 +747,35 @@ is_thread (struct thread *t)
   return t != NULL && t->magic == THREAD_MAGIC;
 }
 
+/* Obtains a page for a new thread, from the cache of dead
+   threads' pages if possible, and stores a tid for the thread in
+   *TID.  Returns a null pointer if no page is available.
+
+   The page's contents are arbitrary.  init_thread() clears the
+   `struct thread', and nothing needs the rest of the page, which
+   is stack, to be zeroed. */
+static struct thread *
+alloc_thread (tid_t *tid)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt > 0)
+    t = thread_cache[--thread_cache_cnt];
+  intr_set_level (old_level);
+
+  if (t != NULL)
+    *tid = t->tid;
+  else
+    {
+      t = palloc_get_page (0);
+      if (t != NULL)
+        *tid = allocate_tid ();
+    }
+  return t;
+}
+
 /* Does basic initialization of T as a blocked thread named
    NAME. */
 static void
@@ -513,17 +820,99 @@ alloc_frame (struct thread *t, size_t size)
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   return a thread from the current CPU's run queue, unless the
+   run queue is empty.  (If the running thread can continue
+   running, then it will be in the run queue.)  If the run queue
+   is empty, try to steal a thread from another CPU, and failing
+   that return the CPU's idle thread. */
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+  struct cpu *c = running_thread ()->cpu;
+  struct thread *t;
+
+  if (!list_empty (&c->ready_list))
+    return list_entry (list_pop_front (&c->ready_list), struct thread, elem);
+
+  t = steal_thread (c);
+  return t != NULL ? t : c->idle_thread;
+}
+
+/* Removes and returns a thread that CPU C may run from another
+   CPU's run queue, or returns a null pointer if there is none.
+   Takes the thread that has waited longest on the CPU with the
+   most threads waiting. */
+static struct thread *
+steal_thread (struct cpu *c)
+{
+  struct cpu *victim = NULL;
+  size_t victim_cnt = 0;
+  int i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    if (&cpus[i] != c)
+      {
+        size_t cnt = list_size (&cpus[i].ready_list);
+        if (cnt > victim_cnt)
+          {
+            victim = &cpus[i];
+            victim_cnt = cnt;
+          }
+      }
+
+  if (victim != NULL)
+    {
+      struct list_elem *e;
+
+      for (e = list_begin (&victim->ready_list);
+           e != list_end (&victim->ready_list); e = list_next (e))
+        {
+          struct thread *t = list_entry (e, struct thread, elem);
+          if (thread_is_mobile (t))
+            {
+              list_remove (e);
+              return t;
+            }
+        }
+    }
+  return NULL;
+}
+
+/* Adds T to a run queue: the current CPU's, if T may run
+   anywhere, otherwise the bootstrap processor's.  Unless T is
+   the running thread, also wakes up an idle CPU that can run T,
+   if there is one.  Interrupts must be off. */
+static void
+thread_enqueue (struct thread *t)
+{
+  struct thread *cur = running_thread ();
+  struct cpu *c = thread_is_mobile (t) ? cur->cpu : &cpus[0];
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_push_back (&c->ready_list, &t->elem);
+  if (c != cur->cpu)
+    cpu_wake (c);
+  else if (t != cur && thread_is_mobile (t))
+    cpu_wake_any ();
+}
+
+/* Returns true if T may run on any CPU, false if it must run on
+   the bootstrap processor.
+
+   Only the bootstrap processor runs kernel threads.  Kernel code
+   written for one CPU may busy-wait for an interrupt, which
+   would never come if the bootstrap processor were waiting for
+   the kernel lock at the time, so a thread may move to other
+   CPUs only while it belongs to a user process. */
+static bool
+thread_is_mobile (struct thread *t UNUSED)
+{
+#ifdef USERPROG
+  return t->pagedir != NULL;
+#else
+  return false;
+#endif
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -553,7 +942,7 @@ thread_schedule_tail (struct thread *prev)
   cur->status = THREAD_RUNNING;
 
   /* Start new time slice. */
-  thread_ticks = 0;
+  cur->cpu->thread_ticks = 0;
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -579,8 +968,16 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  next->cpu = cur->cpu;
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      if (cur->status == THREAD_BLOCKED)
+        cur->voluntary_switches++;
+      else if (cur->status == THREAD_READY)
+        cur->involuntary_switches++;
+      trace (TRACE_SWITCH, next->tid, cur->status, 0);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -4,12 +4,16 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <syscall-nr.h>
 #include "threads/synch.h"
 
 
 #define MAX_FILE_DESC_COUNT 32
 
+struct cpu;
 struct file;
+struct aio_context;
+struct thread_stat;
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -95,9 +99,16 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct cpu *cpu;                    /* CPU last run on. */
+    int64_t run_ticks;                  /* Timer ticks spent running. */
+    unsigned voluntary_switches;        /* Switches away when blocking. */
+    unsigned involuntary_switches;      /* Switches away when ready. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct semaphore *interrupt_sema;   /* Semaphore waited on by
+                                           sema_down_interruptible(). */
+    bool interrupted;                   /* Set by thread_interrupt(). */
 
     /* for assignment 2 file descriptor */
     struct file* file_desc[MAX_FILE_DESC_COUNT];   /* my file dsecriptor table */
@@ -106,6 +117,23 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    uint8_t *heap_start;                /* Start of heap. */
+    uint8_t *heap_end;                  /* End of heap (program break). */
+    struct thread *process;             /* Process's first thread, or null. */
+    int stack_slot;                     /* User thread's stack slot. */
+
+    /* Used only in a process's first thread. */
+    int thread_cnt;                     /* Number of other live threads. */
+    uint32_t stack_slots;               /* Bitmap of stack slots in use. */
+    struct semaphore threads_done;      /* Upped when thread_cnt hits 0. */
+    struct aio_context *aio;            /* Asynchronous I/O, or null. */
+    bool dying;                         /* Other threads must exit. */
+
+    /* Owned by userprog/syscall.c and userprog/exception.c. */
+    unsigned syscall_cnt[SYS_CNT];      /* System calls made, by number. */
+    uint64_t read_bytes;                /* Bytes read by system calls. */
+    uint64_t write_bytes;               /* Bytes written by system calls. */
+    unsigned page_faults;               /* Page faults taken. */
 #endif
 
     /* Owned by thread.c. */
@@ -130,6 +158,8 @@ extern bool thread_mlfqs;
 
 void thread_init (void);
 void thread_start (void);
+void *thread_init_ap (struct cpu *);
+void thread_start_ap (void) NO_RETURN;
 
 void thread_tick (void);
 void thread_print_stats (void);
@@ -139,6 +169,7 @@ tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
+void thread_interrupt (struct thread *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -146,10 +177,14 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+int thread_join (tid_t);
+void thread_free (struct thread *);
+int thread_reset (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
 void thread_foreach (thread_action_func *, void *);
+tid_t thread_get_stats (tid_t, struct thread_stat *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
@@ -0,0 +1,340 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Default size of each CPU's ring buffer, in pages. */
+#define TRACE_DEFAULT_PAGES 64
+
+/* Events per sector of a saved trace. */
+#define EVENTS_PER_SECTOR (BLOCK_SECTOR_SIZE / sizeof (struct trace_event))
+
+/* Ring buffer for one CPU.  Only that CPU writes to it, with
+   interrupts off, so it needs no lock. */
+struct trace_cpu
+  {
+    struct trace_event *events; /* Ring buffer, or null if none. */
+    uint32_t head;              /* Number of events ever recorded. */
+  };
+
+static struct trace_cpu trace_cpus[CPU_MAX];
+
+/* Is tracing enabled? */
+bool trace_enabled;
+
+/* Size of each ring buffer, in pages and in events. */
+static size_t trace_pages;
+static uint32_t event_cap;
+
+/* Time-stamp counter and timer ticks at trace_init(), for
+   working out the time-stamp counter's frequency. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+static void record (enum trace_type, int tid, const uint32_t arg[4]);
+static void record_thread (struct thread *, void *aux);
+static struct block *find_scratch (void);
+static bool save_trace (struct block *, struct trace_header *);
+static void print_trace (struct trace_header *);
+
+/* Returns the time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the running thread.  Unlike thread_current(), this
+   works in the middle of a thread switch, when the running
+   thread is no longer in the THREAD_RUNNING state. */
+static inline struct thread *
+running_thread (void)
+{
+  uint32_t *esp;
+  asm ("mov %%esp, %0" : "=g" (esp));
+  return pg_round_down (esp);
+}
+
+/* Enables tracing into a ring buffer of PAGES pages per CPU, or
+   TRACE_DEFAULT_PAGES if PAGES is 0.  Called for the -trace
+   kernel option. */
+void
+trace_configure (int pages)
+{
+  trace_pages = pages > 0 ? pages : TRACE_DEFAULT_PAGES;
+  event_cap = trace_pages * PGSIZE / sizeof (struct trace_event);
+  trace_enabled = true;
+}
+
+/* Allocates the bootstrap processor's ring buffer, if tracing
+   is enabled.  Must be called after palloc_init(). */
+void
+trace_init (void)
+{
+  if (!trace_enabled)
+    return;
+
+  start_tsc = rdtsc ();
+  start_ticks = timer_ticks ();
+  trace_init_cpu (&cpus[0]);
+}
+
+/* Allocates the ring buffer for CPU C, if tracing is enabled.
+   Called for each application processor before it starts. */
+void
+trace_init_cpu (struct cpu *c)
+{
+  struct trace_event *events;
+
+  if (!trace_enabled)
+    return;
+
+  events = palloc_get_multiple (0, trace_pages);
+  if (events == NULL)
+    printf ("Trace: out of memory, not tracing CPU %d.\n", c->id);
+  trace_cpus[c->id].events = events;
+}
+
+/* Records an event of type TYPE with the given arguments in the
+   current CPU's ring buffer.  Use trace() instead, which skips
+   the call if tracing is disabled. */
+void
+trace_record (enum trace_type type, uint32_t arg0, uint32_t arg1,
+              uint32_t arg2)
+{
+  uint32_t arg[4];
+
+  arg[0] = arg0;
+  arg[1] = arg1;
+  arg[2] = arg2;
+  arg[3] = 0;
+  record (type, running_thread ()->tid, arg);
+}
+
+/* Records that thread TID is named NAME. */
+void
+trace_thread (int tid, const char *name)
+{
+  uint32_t arg[4];
+
+  if (!trace_enabled)
+    return;
+
+  memset (arg, 0, sizeof arg);
+  strlcpy ((char *) arg, name, sizeof arg);
+  record (TRACE_THREAD, tid, arg);
+}
+
+/* Records an event of type TYPE for thread TID, with arguments
+   ARG, in the current CPU's ring buffer, overwriting the oldest
+   event if the buffer is full. */
+static void
+record (enum trace_type type, int tid, const uint32_t arg[4])
+{
+  enum intr_level old_level = intr_disable ();
+  struct thread *t = running_thread ();
+  struct cpu *c = cpu_cnt > 1 ? t->cpu : &cpus[0];
+  struct trace_cpu *tc = &trace_cpus[c->id];
+
+  if (tc->events != NULL)
+    {
+      struct trace_event *e = &tc->events[tc->head++ % event_cap];
+      e->tsc = rdtsc ();
+      e->type = type;
+      e->cpu = c->id;
+      e->tid = tid;
+      memcpy (e->arg, arg, sizeof e->arg);
+    }
+  intr_set_level (old_level);
+}
+
+/* Stops tracing and saves the trace, if tracing is enabled.
+   The trace goes at the end of the scratch device, if there is
+   one and interrupts are on to drive it, and otherwise to the
+   console as "trace" lines.  The "pintos" script and
+   utils/pintos-trace read it from either place. */
+void
+trace_dump (void)
+{
+  struct trace_header h;
+  struct block *scratch;
+  enum intr_level old_level;
+  int64_t ticks;
+  int i;
+
+  if (!trace_enabled)
+    return;
+
+  /* Name every thread still around, in case the events that
+     named them have been overwritten, then stop. */
+  old_level = intr_disable ();
+  thread_foreach (record_thread, NULL);
+  trace_enabled = false;
+  intr_set_level (old_level);
+
+  memset (&h, 0, sizeof h);
+  memcpy (h.magic, TRACE_MAGIC, sizeof h.magic);
+  h.event_size = sizeof (struct trace_event);
+  h.cpu_cnt = cpu_cnt;
+  ticks = timer_ticks () - start_ticks;
+  if (ticks > 0)
+    h.tsc_hz = (rdtsc () - start_tsc) * TIMER_FREQ / ticks;
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      struct trace_cpu *tc = &trace_cpus[i];
+      if (tc->events == NULL)
+        continue;
+      h.event_cnt[i] = tc->head < event_cap ? tc->head : event_cap;
+      h.lost_cnt[i] = tc->head - h.event_cnt[i];
+    }
+
+  scratch = find_scratch ();
+  if (scratch == NULL || intr_get_level () == INTR_OFF || intr_context ()
+      || !save_trace (scratch, &h))
+    print_trace (&h);
+}
+
+/* Records the name of thread T.  Used with thread_foreach(). */
+static void
+record_thread (struct thread *t, void *aux UNUSED)
+{
+  trace_thread (t->tid, t->name);
+}
+
+/* Returns the scratch block device, or a null pointer if there
+   is none.  Without the file system, no block device has been
+   given the scratch role, so take the first scratch partition. */
+static struct block *
+find_scratch (void)
+{
+  struct block *block = block_get_role (BLOCK_SCRATCH);
+
+  if (block == NULL)
+    for (block = block_first (); block != NULL; block = block_next (block))
+      if (block_type (block) == BLOCK_SCRATCH)
+        break;
+  return block;
+}
+
+/* Calls FUNC for each of CPU C's saved events, oldest first,
+   with H describing the trace. */
+static void
+for_each_event (const struct trace_header *h, int c,
+                void (*func) (const struct trace_event *, void *aux),
+                void *aux)
+{
+  const struct trace_cpu *tc = &trace_cpus[c];
+  uint32_t i;
+
+  for (i = tc->head - h->event_cnt[c]; i != tc->head; i++)
+    func (&tc->events[i % event_cap], aux);
+}
+
+/* A sector of events on its way to the scratch device. */
+struct sector_buffer
+  {
+    struct block *block;        /* Scratch device. */
+    block_sector_t sector;      /* Next sector to write. */
+    struct trace_event events[EVENTS_PER_SECTOR];
+    size_t event_cnt;           /* Number of events in EVENTS. */
+  };
+
+/* Adds E to the sector buffer AUX, writing the buffer out when
+   it fills. */
+static void
+buffer_event (const struct trace_event *e, void *aux)
+{
+  struct sector_buffer *b = aux;
+
+  b->events[b->event_cnt++] = *e;
+  if (b->event_cnt == EVENTS_PER_SECTOR)
+    {
+      block_write (b->block, b->sector++, b->events);
+      b->event_cnt = 0;
+    }
+}
+
+/* Writes the trace described by H to the end of SCRATCH: the
+   header goes in the last sector, and the events, CPU by CPU,
+   in the sectors just before it.  Returns false, without
+   writing anything, if SCRATCH is too small. */
+static bool
+save_trace (struct block *scratch, struct trace_header *h)
+{
+  static struct sector_buffer b;
+  block_sector_t sector_cnt;
+  size_t event_cnt = 0;
+  int i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    event_cnt += h->event_cnt[i];
+  sector_cnt = DIV_ROUND_UP (event_cnt, EVENTS_PER_SECTOR);
+  if (sector_cnt >= block_size (scratch))
+    {
+      printf ("Trace: %s too small for %zu events.\n",
+              block_name (scratch), event_cnt);
+      return false;
+    }
+
+  b.block = scratch;
+  b.sector = block_size (scratch) - 1 - sector_cnt;
+  b.event_cnt = 0;
+  for (i = 0; i < cpu_cnt; i++)
+    for_each_event (h, i, buffer_event, &b);
+  if (b.event_cnt > 0)
+    {
+      memset (b.events + b.event_cnt, 0,
+              sizeof b.events - b.event_cnt * sizeof *b.events);
+      block_write (scratch, b.sector, b.events);
+    }
+  block_write (scratch, block_size (scratch) - 1, h);
+
+  printf ("Trace: %zu events saved to %s.\n", event_cnt, block_name (scratch));
+  return true;
+}
+
+/* Prints SIZE bytes at P as a "trace" line in hex. */
+static void
+print_hex (const void *p_, size_t size)
+{
+  const uint8_t *p = p_;
+  size_t i;
+
+  printf ("trace ");
+  for (i = 0; i < size; i++)
+    printf ("%02x", p[i]);
+  printf ("\n");
+}
+
+/* Prints event E as a "trace" line.  Used with for_each_event(). */
+static void
+print_event (const struct trace_event *e, void *aux UNUSED)
+{
+  print_hex (e, sizeof *e);
+}
+
+/* Prints the trace described by H as "trace" lines, each with
+   an event's worth of bytes in hex: first the header, then the
+   events, CPU by CPU. */
+static void
+print_trace (struct trace_header *h)
+{
+  size_t ofs;
+  int i;
+
+  for (ofs = 0; ofs < sizeof *h; ofs += sizeof (struct trace_event))
+    print_hex ((uint8_t *) h + ofs, sizeof (struct trace_event));
+  for (i = 0; i < cpu_cnt; i++)
+    for_each_event (h, i, print_event, NULL);
+}
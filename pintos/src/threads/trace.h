@@ -0,0 +1,90 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct cpu;
+
+/* Kernel event tracer.
+
+   When enabled with the -trace kernel option, the kernel records
+   scheduling, locking, interrupt, and block I/O events, each
+   stamped with the CPU's time-stamp counter, in a ring buffer
+   kept by the CPU on which the event happened.  Recording an
+   event takes no lock and prints nothing, so it disturbs timing
+   far less than printf().  At power off the buffers are saved
+   at the end of the scratch device, or printed if there is none,
+   and utils/pintos-trace turns them into a timeline for a Chrome
+   trace viewer. */
+
+/* Types of events. */
+enum trace_type
+  {
+    TRACE_THREAD = 1,           /* Thread TID is named NAME. */
+    TRACE_SWITCH,               /* TID switches to thread ARG[0];
+                                   TID's new status is ARG[1]. */
+    TRACE_BLOCK,                /* TID blocks. */
+    TRACE_UNBLOCK,              /* TID unblocks thread ARG[0]. */
+    TRACE_LOCK_ACQUIRE,         /* TID starts to acquire lock ARG[0]. */
+    TRACE_LOCK_ACQUIRED,        /* TID acquires lock ARG[0]. */
+    TRACE_LOCK_RELEASE,         /* TID releases lock ARG[0]. */
+    TRACE_INTR_ENTER,           /* Interrupt ARG[0] starts. */
+    TRACE_INTR_EXIT,            /* Interrupt ARG[0] is handled. */
+    TRACE_IO_SUBMIT,            /* Sector ARG[1] of the block device
+                                   of type ARG[0] (an enum block_type)
+                                   to be read (ARG[2] = 0) or
+                                   written (ARG[2] = 1). */
+    TRACE_IO_COMPLETE           /* That access completes. */
+  };
+
+/* A recorded event.  Also the format of the saved trace, which
+   is a struct trace_header followed by each CPU's events, oldest
+   first. */
+struct trace_event
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    uint16_t type;              /* A TRACE_* value. */
+    uint16_t cpu;               /* CPU on which it happened. */
+    int32_t tid;                /* Running thread, or 0 if none. */
+    union
+      {
+        uint32_t arg[4];        /* Arguments, by type. */
+        char name[16];          /* TRACE_THREAD: thread name. */
+      };
+  };
+
+/* Header of a saved trace, one sector long. */
+#define TRACE_MAGIC "PINTRACE"
+struct trace_header
+  {
+    char magic[8];              /* TRACE_MAGIC, not null-terminated. */
+    uint32_t event_size;        /* sizeof (struct trace_event). */
+    uint32_t cpu_cnt;           /* Number of CPUs. */
+    uint64_t tsc_hz;            /* Time-stamp counter ticks per second. */
+    uint32_t event_cnt[8];      /* Events saved for each CPU (CPU_MAX). */
+    uint32_t lost_cnt[8];       /* Older events each CPU overwrote. */
+    uint8_t unused[512 - 88];
+  };
+
+/* Is tracing enabled?  Only trace_configure() sets this. */
+extern bool trace_enabled;
+
+void trace_configure (int pages);
+void trace_init (void);
+void trace_init_cpu (struct cpu *);
+void trace_record (enum trace_type, uint32_t arg0, uint32_t arg1,
+                   uint32_t arg2);
+void trace_thread (int tid, const char *name);
+void trace_dump (void);
+
+/* Records an event of type TYPE with the given arguments, if
+   tracing is enabled. */
+static inline void
+trace (enum trace_type type, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+  if (trace_enabled)
+    trace_record (type, arg0, arg1, arg2);
+}
+
+#endif /* threads/trace.h */
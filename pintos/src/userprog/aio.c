@@ -0,0 +1,357 @@
+#include "userprog/aio.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+
+/* Asynchronous I/O.
+
+   A process registers a struct io_ring (see lib/aio.h) in its
+   own memory with io_setup().  The kernel keeps the ring's
+   kernel virtual address, so that it can read submissions and
+   post completions without copying, from any thread.
+
+   io_submit() takes entries off the submission queue, checks
+   them, and puts them on a queue shared by AIO_WORKERS kernel
+   threads, then returns without waiting.  The workers carry out
+   the transfers through the kernel aliases of the user buffer's
+   pages and post completions as they finish, so a process can
+   have several transfers in flight while it computes, and a
+   transfer can proceed while another waits for the disk.
+
+   Each request works on its own reopening of the file, so that
+   closing the descriptor with requests in flight is harmless,
+   and at an explicit offset, so that it doesn't move the file
+   position. */
+
+/* Number of worker threads. */
+#define AIO_WORKERS 4
+
+/* A process's asynchronous I/O state. */
+struct aio_context
+  {
+    struct lock lock;           /* Protects the completion queue. */
+    struct condition done;      /* Signaled on each completion. */
+    struct io_ring *ring;       /* Kernel address of the ring. */
+    const void *uring;          /* User address of the ring. */
+    uint32_t *pagedir;          /* Page directory of the buffers. */
+    int inflight;               /* Requests taken but not completed. */
+  };
+
+/* A request waiting for, or being handled by, a worker. */
+struct aio_request
+  {
+    struct list_elem elem;      /* Element in the request queue. */
+    struct aio_context *ctx;    /* Submitting process's context. */
+    struct file *file;          /* Private reopening of the file. */
+    struct io_sqe sqe;          /* Copy of the submission. */
+  };
+
+/* Requests not yet taken by a worker. */
+static struct list requests;
+static struct lock requests_lock;
+static struct condition requests_ready;
+
+static thread_func worker NO_RETURN;
+
+/* Initializes the request queue and starts the workers. */
+void
+aio_init (void)
+{
+  int i;
+
+  list_init (&requests);
+  lock_init (&requests_lock);
+  cond_init (&requests_ready);
+  for (i = 0; i < AIO_WORKERS; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "aio%d", i);
+      thread_create (name, PRI_DEFAULT, worker, NULL);
+    }
+}
+
+/* Registers the ring at URING, which must not cross a page
+   boundary, for the current process, and empties its queues.
+   Returns 0 if successful, -1 if URING is not a valid, mapped,
+   aligned user address or the process already has a ring. */
+int
+aio_setup (struct io_ring *uring)
+{
+  struct thread *process = process_of (thread_current ());
+  struct aio_context *ctx;
+  struct io_ring *ring;
+
+  if ((uintptr_t) uring % sizeof (unsigned) != 0
+      || !is_user_vaddr (uring)
+      || pg_ofs (uring) + sizeof *ring > PGSIZE
+      || process->aio != NULL)
+    return -1;
+  ring = pagedir_get_page (process->pagedir, uring);
+  if (ring == NULL)
+    return -1;
+
+  ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    return -1;
+  lock_init (&ctx->lock);
+  cond_init (&ctx->done);
+  ctx->ring = ring;
+  ctx->uring = uring;
+  ctx->pagedir = process->pagedir;
+  ctx->inflight = 0;
+  ring->sq_head = ring->sq_tail = 0;
+  ring->cq_head = ring->cq_tail = 0;
+  process->aio = ctx;
+  return 0;
+}
+
+/* Returns the current process's context, or a null pointer if
+   it has not called io_setup(). */
+static struct aio_context *
+current_context (void)
+{
+  return process_of (thread_current ())->aio;
+}
+
+/* Posts a completion of RESULT for USER_DATA to CTX. */
+static void
+complete (struct aio_context *ctx, unsigned user_data, int result)
+{
+  struct io_ring *ring = ctx->ring;
+  struct io_cqe *cqe;
+
+  lock_acquire (&ctx->lock);
+  cqe = &ring->cqes[ring->cq_tail % IO_RING_ENTRIES];
+  cqe->user_data = user_data;
+  cqe->result = result;
+  barrier ();
+  ring->cq_tail++;
+  ctx->inflight--;
+  cond_broadcast (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+}
+
+/* Returns true if every page of the SIZE bytes at UADDR is a
+   mapped user page in PD. */
+static bool
+is_mapped (uint32_t *pd, const uint8_t *uaddr, unsigned size)
+{
+  const uint8_t *upage;
+
+  if (size == 0)
+    return true;
+  if (uaddr + size < uaddr || !is_user_vaddr (uaddr + size - 1))
+    return false;
+  for (upage = pg_round_down (uaddr); upage < uaddr + size;
+       upage += PGSIZE)
+    if (pagedir_get_page (pd, upage) == NULL)
+      return false;
+  return true;
+}
+
+/* Returns a request for SQE on CTX, or a null pointer if SQE is
+   not valid. */
+static struct aio_request *
+make_request (struct aio_context *ctx, const struct io_sqe *sqe)
+{
+  struct file *file = process_get_file (sqe->fd);
+  struct aio_request *r;
+
+  if ((sqe->op != IO_READ && sqe->op != IO_WRITE)
+      || file == NULL || file_is_pipe (file)
+      || (int) sqe->size < 0 || (int) sqe->offset < 0
+      || !is_mapped (ctx->pagedir, sqe->buf, sqe->size))
+    return NULL;
+
+  r = malloc (sizeof *r);
+  if (r == NULL)
+    return NULL;
+  r->file = file_reopen (file);
+  if (r->file == NULL)
+    {
+      free (r);
+      return NULL;
+    }
+  r->ctx = ctx;
+  r->sqe = *sqe;
+  return r;
+}
+
+/* Takes up to CNT entries off the current process's submission
+   queue and starts them.  An entry that is not valid completes
+   at once with a result of -1.  Stops early when the completion
+   queue has no room for another request.  Returns the number of
+   entries taken, or -1 if the process has no ring. */
+int
+aio_submit (int cnt)
+{
+  struct aio_context *ctx = current_context ();
+  struct io_ring *ring;
+  int taken;
+
+  if (ctx == NULL)
+    return -1;
+
+  ring = ctx->ring;
+  for (taken = 0; taken < cnt && ring->sq_head != ring->sq_tail; taken++)
+    {
+      struct io_sqe sqe;
+      struct aio_request *r;
+      bool full;
+
+      lock_acquire (&ctx->lock);
+      full = ctx->inflight + (ring->cq_tail - ring->cq_head)
+             >= IO_RING_ENTRIES;
+      if (!full)
+        ctx->inflight++;
+      lock_release (&ctx->lock);
+      if (full)
+        break;
+
+      sqe = ring->sqes[ring->sq_head % IO_RING_ENTRIES];
+      barrier ();
+      ring->sq_head++;
+
+      r = make_request (ctx, &sqe);
+      if (r == NULL)
+        {
+          complete (ctx, sqe.user_data, -1);
+          continue;
+        }
+      lock_acquire (&requests_lock);
+      list_push_back (&requests, &r->elem);
+      cond_signal (&requests_ready, &requests_lock);
+      lock_release (&requests_lock);
+    }
+  return taken;
+}
+
+/* Waits until the current process's completion queue holds at
+   least MIN_COMPLETE entries, or until it has no requests in
+   flight, and returns the number of entries in the queue.
+   Returns -1 if the process has no ring. */
+int
+aio_wait (int min_complete)
+{
+  struct aio_context *ctx = current_context ();
+  struct io_ring *ring;
+  int cnt;
+
+  if (ctx == NULL)
+    return -1;
+
+  ring = ctx->ring;
+  lock_acquire (&ctx->lock);
+  while ((int) (ring->cq_tail - ring->cq_head) < min_complete
+         && ctx->inflight > 0)
+    cond_wait (&ctx->done, &ctx->lock);
+  cnt = ring->cq_tail - ring->cq_head;
+  lock_release (&ctx->lock);
+  return cnt;
+}
+
+/* Waits for all of CTX's requests to complete. */
+static void
+drain (struct aio_context *ctx)
+{
+  lock_acquire (&ctx->lock);
+  while (ctx->inflight > 0)
+    cond_wait (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+}
+
+/* Called before PROCESS unmaps the user pages from START up to
+   END.  Waits for requests in flight, which might be using those
+   pages, and forgets the ring if it is among them. */
+void
+aio_unmap (struct thread *process, void *start, void *end)
+{
+  struct aio_context *ctx = process->aio;
+
+  if (ctx == NULL)
+    return;
+  drain (ctx);
+  if (ctx->uring >= start && ctx->uring < end)
+    aio_exit (process);
+}
+
+/* Waits for PROCESS's requests in flight and frees its
+   asynchronous I/O state. */
+void
+aio_exit (struct thread *process)
+{
+  struct aio_context *ctx = process->aio;
+
+  if (ctx == NULL)
+    return;
+  drain (ctx);
+  process->aio = NULL;
+  free (ctx);
+}
+
+/* Carries out request R.  Returns the number of bytes
+   transferred, which is short if the end of file was reached or
+   part of the buffer was unmapped. */
+static int
+transfer (struct aio_request *r)
+{
+  uint8_t *ubuf = r->sqe.buf;
+  off_t ofs = r->sqe.offset;
+  unsigned left = r->sqe.size;
+  int total = 0;
+
+  while (left > 0)
+    {
+      size_t chunk = PGSIZE - pg_ofs (ubuf);
+      uint8_t *kbuf = pagedir_get_page (r->ctx->pagedir, ubuf);
+      off_t n;
+
+      if (kbuf == NULL)
+        break;
+      if (chunk > left)
+        chunk = left;
+      if (r->sqe.op == IO_READ)
+        n = file_read_at (r->file, kbuf, chunk, ofs);
+      else
+        n = file_write_at (r->file, kbuf, chunk, ofs);
+      total += n;
+      if ((size_t) n != chunk)
+        break;
+
+      ubuf += chunk;
+      ofs += chunk;
+      left -= chunk;
+    }
+  return total;
+}
+
+/* Worker thread.  Carries out requests in the order they were
+   submitted, forever. */
+static void
+worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct aio_request *r;
+      int result;
+
+      lock_acquire (&requests_lock);
+      while (list_empty (&requests))
+        cond_wait (&requests_ready, &requests_lock);
+      r = list_entry (list_pop_front (&requests), struct aio_request, elem);
+      lock_release (&requests_lock);
+
+      result = transfer (r);
+      file_close (r->file);
+      complete (r->ctx, r->sqe.user_data, result);
+      free (r);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <aio.h>
+#include "threads/thread.h"
+
+void aio_init (void);
+int aio_setup (struct io_ring *);
+int aio_submit (int cnt);
+int aio_wait (int min_complete);
+void aio_unmap (struct thread *process, void *start, void *end);
+void aio_exit (struct thread *process);
+
+#endif /* userprog/aio.h */
@@ -148,6 +148,7 @@ page_fault (struct intr_frame *f)
 
   /* Count page faults. */
   page_fault_cnt++;
+  thread_current ()->page_faults++;
 
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
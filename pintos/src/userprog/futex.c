@@ -0,0 +1,154 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Futexes ("fast user-space mutexes").
+
+   A futex is just an aligned int in user memory.  User code
+   manipulates it with atomic instructions and calls into the
+   kernel only to sleep until the int changes (futex_wait()) or
+   to wake up sleepers after changing it (futex_wake()), so
+   synchronization that doesn't have to wait never makes a system
+   call.  lib/user/synch.c builds locks and condition variables
+   this way.
+
+   Sleepers are kept in a hash table of wait queues.  A futex is
+   identified by the kernel virtual address of the memory behind
+   it, that is, by its physical address, so that it would work
+   the same if the page were mapped at different addresses in
+   different page directories. */
+
+/* Number of hash buckets.  Must be a power of 2. */
+#define FUTEX_BUCKETS 64
+
+/* A bucket of the wait-queue hash table. */
+struct futex_bucket
+  {
+    struct lock lock;           /* Protects WAITERS. */
+    struct list waiters;        /* List of struct futex_waiter. */
+  };
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter
+  {
+    struct list_elem elem;      /* Element in bucket's WAITERS. */
+    const int *key;             /* Kernel address of the futex. */
+    struct semaphore sema;      /* Upped to wake the thread. */
+  };
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void)
+{
+  int i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    {
+      lock_init (&buckets[i].lock);
+      list_init (&buckets[i].waiters);
+    }
+}
+
+/* Returns the kernel virtual address of the futex at UADDR in
+   the current process, or a null pointer if UADDR is not a
+   valid, mapped, aligned user address. */
+static const int *
+futex_key (const int *uaddr)
+{
+  if ((uintptr_t) uaddr % sizeof *uaddr != 0 || !is_user_vaddr (uaddr))
+    return NULL;
+  return pagedir_get_page (thread_current ()->pagedir, uaddr);
+}
+
+/* Returns the hash bucket for KEY. */
+static struct futex_bucket *
+key_bucket (const int *key)
+{
+  return &buckets[hash_int ((uintptr_t) key) & (FUTEX_BUCKETS - 1)];
+}
+
+/* If the futex at UADDR still holds VAL, sleeps until woken up
+   by futex_wake() and returns 0.  Returns -1 without sleeping if
+   the futex holds some other value or if UADDR is not valid, and
+   -1 if the sleep is cut short by the process exiting.
+
+   The futex is compared with VAL and the thread is queued under
+   the same lock that futex_wake() takes, so a wakeup sent after
+   another thread changed the futex cannot be lost. */
+int
+futex_wait (int *uaddr, int val)
+{
+  const int *key = futex_key (uaddr);
+  struct futex_bucket *b;
+  struct futex_waiter w;
+
+  if (key == NULL)
+    return -1;
+
+  b = key_bucket (key);
+  lock_acquire (&b->lock);
+  if (*key != val)
+    {
+      lock_release (&b->lock);
+      return -1;
+    }
+  w.key = key;
+  sema_init (&w.sema, 0);
+  list_push_back (&b->waiters, &w.elem);
+  lock_release (&b->lock);
+
+  if (sema_down_interruptible (&w.sema))
+    return 0;
+
+  /* Interrupted because the process is exiting.  futex_wake()
+     dequeues a waiter and ups its semaphore under the bucket
+     lock, so W is still queued unless it was woken. */
+  lock_acquire (&b->lock);
+  if (w.sema.value == 0)
+    list_remove (&w.elem);
+  lock_release (&b->lock);
+  return -1;
+}
+
+/* Wakes up at most N threads waiting on the futex at UADDR, in
+   the order that they started waiting.  Returns the number
+   woken, or -1 if UADDR is not valid. */
+int
+futex_wake (int *uaddr, int n)
+{
+  const int *key = futex_key (uaddr);
+  struct futex_bucket *b;
+  struct list_elem *e;
+  int woken = 0;
+
+  if (key == NULL)
+    return -1;
+
+  b = key_bucket (key);
+  lock_acquire (&b->lock);
+  for (e = list_begin (&b->waiters);
+       e != list_end (&b->waiters) && woken < n; )
+    {
+      struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+
+      if (w->key == key)
+        {
+          e = list_remove (e);
+          sema_up (&w->sema);
+          woken++;
+        }
+      else
+        e = list_next (e);
+    }
+  lock_release (&b->lock);
+
+  return woken;
+}
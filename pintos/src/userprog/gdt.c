@@ -1,6 +1,8 @@
 #include "userprog/gdt.h"
 #include <debug.h>
 #include "userprog/tss.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
@@ -21,7 +23,10 @@
 
    For more information on the GDT as used here, refer to
    [IA32-v3a] 3.2 "Using Segments" through 3.5 "System Descriptor
-   Types". */
+   Types".
+
+   All CPUs share the GDT, but each has its own TSS and thus its
+   own TSS descriptor. */
 static uint64_t gdt[SEL_CNT];
 
 /* GDT helpers. */
@@ -35,7 +40,7 @@ static uint64_t make_gdtr_operand (uint16_t limit, void *base);
 void
 gdt_init (void)
 {
-  uint64_t gdtr_operand;
+  int i;
 
   /* Initialize GDT. */
   gdt[SEL_NULL / sizeof *gdt] = 0;
@@ -43,14 +48,27 @@ gdt_init (void)
   gdt[SEL_KDSEG / sizeof *gdt] = make_data_desc (0);
   gdt[SEL_UCSEG / sizeof *gdt] = make_code_desc (3);
   gdt[SEL_UDSEG / sizeof *gdt] = make_data_desc (3);
-  gdt[SEL_TSS / sizeof *gdt] = make_tss_desc (tss_get ());
+  for (i = 0; i < CPU_MAX; i++)
+    gdt[SEL_TSS_CPU (i) / sizeof *gdt] = make_tss_desc (tss_get (i));
+
+  gdt_init_ap ();
+}
+
+/* Loads the GDT and the current CPU's TSS.  gdt_init() does
+   this for the bootstrap processor. */
+void
+gdt_init_ap (void)
+{
+  uint64_t gdtr_operand;
+
+  ASSERT (intr_get_level () == INTR_OFF);
 
   /* Load GDTR, TR.  See [IA32-v3a] 2.4.1 "Global Descriptor
      Table Register (GDTR)", 2.4.4 "Task Register (TR)", and
      6.2.4 "Task Register".  */
   gdtr_operand = make_gdtr_operand (sizeof gdt - 1, gdt);
   asm volatile ("lgdt %0" : : "m" (gdtr_operand));
-  asm volatile ("ltr %w0" : : "q" (SEL_TSS));
+  asm volatile ("ltr %w0" : : "q" (SEL_TSS_CPU (cpu_current ()->id)));
 }
 
 /* System segment or code/data segment? */
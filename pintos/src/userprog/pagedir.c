@@ -18,10 +18,31 @@ pagedir_create (void)
 {
   uint32_t *pd = palloc_get_page (0);
   if (pd != NULL)
-    memcpy (pd, init_page_dir, PGSIZE);
+    {
+      memset (pd, 0, pd_no (PHYS_BASE) * sizeof *pd);
+      pagedir_share_kernel (pd);
+    }
   return pd;
 }
 
+/* Makes the kernel half of page directory PD share the kernel's
+   mappings in init_page_dir.
+
+   The CPU requires every page directory to have its own PDEs for
+   kernel virtual addresses, but these PDEs point to the same page
+   tables and 4 MB pages as init_page_dir's, and all of those
+   mappings are global, so switching between page directories
+   with pagedir_activate() does not flush them from the TLB. */
+void
+pagedir_share_kernel (uint32_t *pd)
+{
+  size_t kernel_pde = pd_no (PHYS_BASE);
+
+  ASSERT (pd != init_page_dir);
+  memcpy (pd + kernel_pde, init_page_dir + kernel_pde,
+          (PGSIZE / sizeof *pd - kernel_pde) * sizeof *pd);
+}
+
 /* Destroys page directory PD, freeing all the pages it
    references. */
 void
@@ -80,7 +101,10 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
         return NULL;
     }
 
-  /* Return the page table entry. */
+  /* Return the page table entry.  Kernel virtual addresses may
+     be mapped by a 4 MB page, which has none. */
+  if (*pde & PTE_PS)
+    return NULL;
   pt = pde_get_pt (*pde);
   return &pt[pt_no (vaddr)];
 }
@@ -5,15 +5,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/aio.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
@@ -47,7 +50,28 @@
   }
 
 static thread_func start_process NO_RETURN;
+static thread_func start_thread NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool install_page (void *upage, void *kpage, bool writable);
+static void release_stack_slot (struct thread *process, int slot);
+
+/* Returns the first thread of T's process, which owns the
+   process's file descriptors, heap, and other threads.  A kernel
+   thread is its own "process". */
+struct thread *
+process_of (struct thread *t)
+{
+  return t->process != NULL ? t->process : t;
+}
+
+/* Returns true if T is a thread created by a user process with
+   thread_create(), as opposed to a process's first thread or a
+   kernel thread. */
+static bool
+is_user_thread (struct thread *t)
+{
+  return t->process != NULL && t->process != t;
+}
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -130,6 +154,10 @@ start_process (void *file_name_)
   else
     file_name = NULL;
 
+  /* This thread is the first in a new process. */
+  thread_current ()->process = thread_current ();
+  sema_init (&thread_current ()->threads_done, 0);
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
@@ -151,6 +179,11 @@ start_process (void *file_name_)
 
   /* If load failed, quit. */
   palloc_free_page (file_name_);
+
+  /* The parent is still waiting in exec(), so its descriptor
+     table is stable. */
+  if (success)
+    process_inherit_pipes (parent);
   
   sema_up(&parent->load_program);
   
@@ -166,11 +199,192 @@ start_process (void *file_name_)
      threads/intr-stubs.S).  Because intr_exit takes all of its
      arguments on the stack in the form of a `struct intr_frame',
      we just point the stack pointer (%esp) to our stack frame
-     and jump to it. */
+     and jump to it.  User code runs without the kernel lock
+     (see threads/cpu.h), so we release it first; intr_exit turns
+     interrupts back on as it returns to user mode. */
+  intr_disable ();
+  kernel_lock_release ();
   asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
   NOT_REACHED ();
 }
 
+/* Information passed from process_thread_create() to a new
+   user thread. */
+struct thread_start
+  {
+    void (*eip) (void);         /* User entry stub. */
+    void *func;                 /* Thread function, for the stub. */
+    void *arg;                  /* Argument to FUNC. */
+  };
+
+/* Returns the address just past the top of stack slot SLOT. */
+static uint8_t *
+stack_slot_top (int slot)
+{
+  return (uint8_t *) PHYS_BASE - (slot + 1) * THREAD_STACK_SPAN;
+}
+
+/* Starts a new thread in the current process.  The thread runs
+   EIP, a function in the user program, with FUNC and ARG as its
+   arguments; EIP is expected to call FUNC(ARG) and pass its
+   return value to exit().  The new thread shares the process's
+   address space, file descriptors, and heap, and gets a stack
+   of its own.  Returns the new thread's tid, or TID_ERROR if
+   the process has too many threads or memory is short. */
+tid_t
+process_thread_create (void *eip, void *func, void *arg)
+{
+  struct thread *cur = thread_current ();
+  struct thread *process = process_of (cur);
+  struct thread_start *start;
+  enum intr_level old_level;
+  struct thread *t;
+  uint8_t *upage;
+  int slot;
+  tid_t tid;
+
+  if (!is_user_vaddr (eip) || process->pagedir == NULL || process->dying)
+    return TID_ERROR;
+
+  /* Claim a stack slot and map its pages.  Pages mapped for an
+     earlier thread in the same slot are reused as they are; all
+     of them are freed along with the page directory. */
+  for (slot = 0; slot < USER_THREAD_MAX; slot++)
+    if (!(process->stack_slots & (1u << slot)))
+      break;
+  if (slot >= USER_THREAD_MAX)
+    return TID_ERROR;
+  process->stack_slots |= 1u << slot;
+  for (upage = stack_slot_top (slot) - THREAD_STACK_PAGES * PGSIZE;
+       upage < stack_slot_top (slot); upage += PGSIZE)
+    if (pagedir_get_page (process->pagedir, upage) == NULL)
+      {
+        void *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+        if (kpage == NULL || !install_page (upage, kpage, true))
+          {
+            palloc_free_page (kpage);
+            release_stack_slot (process, slot);
+            return TID_ERROR;
+          }
+      }
+
+  start = malloc (sizeof *start);
+  if (start == NULL)
+    {
+      release_stack_slot (process, slot);
+      return TID_ERROR;
+    }
+  start->eip = (void (*) (void)) eip;
+  start->func = func;
+  start->arg = arg;
+
+  /* With interrupts off, the new thread can't run before we have
+     made it part of the process.  It belongs to the process's
+     first thread, so that any thread in the process can join
+     it. */
+  old_level = intr_disable ();
+  tid = thread_create (process->name, PRI_DEFAULT, start_thread, start);
+  if (tid != TID_ERROR)
+    {
+      t = list_entry (list_back (&cur->child_list), struct thread,
+                      child_elem);
+      ASSERT (t->tid == tid);
+      t->process = process;
+      t->pagedir = process->pagedir;
+      t->stack_slot = slot;
+      if (cur != process)
+        {
+          list_remove (&t->child_elem);
+          list_push_back (&process->child_list, &t->child_elem);
+          t->parent = process;
+        }
+      process->thread_cnt++;
+    }
+  intr_set_level (old_level);
+
+  if (tid == TID_ERROR)
+    {
+      free (start);
+      release_stack_slot (process, slot);
+    }
+  return tid;
+}
+
+/* A thread function that starts a user thread, given the
+   thread_start that process_thread_create() set up. */
+static void
+start_thread (void *start_)
+{
+  struct thread_start *start = start_;
+  struct thread *t = thread_current ();
+  struct intr_frame if_;
+  uint32_t *esp;
+
+  process_activate ();
+
+  /* Give the entry stub its arguments and a null return
+     address. */
+  esp = (uint32_t *) stack_slot_top (t->stack_slot);
+  *--esp = (uint32_t) start->arg;
+  *--esp = (uint32_t) start->func;
+  *--esp = 0;
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = start->eip;
+  if_.esp = esp;
+  free (start);
+
+  /* Jump to user mode, as in start_process(). */
+  intr_disable ();
+  kernel_lock_release ();
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Marks stack slot SLOT free in PROCESS. */
+static void
+release_stack_slot (struct thread *process, int slot)
+{
+  enum intr_level old_level = intr_disable ();
+  process->stack_slots &= ~(1u << slot);
+  intr_set_level (old_level);
+}
+
+/* Waits for TID, a thread created by process_thread_create() in
+   the current process, to exit, and returns the status it
+   passed to exit().  Any thread in the process may join any
+   other, but each thread may be joined only once.  Returns -1
+   immediately if TID is not such a thread, if it is the calling
+   thread, or if it has already been joined. */
+int
+process_thread_join (tid_t tid)
+{
+  struct thread *cur = thread_current ();
+  struct thread *process = process_of (cur);
+  struct list_elem *e;
+
+  for (e = list_begin (&process->child_list);
+       e != list_end (&process->child_list); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, child_elem);
+      if (t->tid == tid && t->process == process && t != cur)
+        {
+          int status;
+
+          /* Remove T first, so that no one else can join it. */
+          list_remove (&t->child_elem);
+          sema_down (&t->exit_program);
+          status = t->exit_status;
+          thread_free (t);
+          return status;
+        }
+    }
+  return -1;
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -191,19 +405,87 @@ process_wait (tid_t child_tid)
   if (child == NULL)
     return -1;
 
-  sema_down (&child->exit_program);
+  if (!sema_down_interruptible (&child->exit_program))
+    return -1;
   ret = child->exit_status;
   remove_child_process (child);
   return ret;
 }
 
+/* Interrupts T if it is one of PROCESS's user threads.  Joined
+   threads are no longer on PROCESS's child_list, so this is used
+   with thread_foreach(). */
+static void
+interrupt_sibling (struct thread *t, void *process)
+{
+  if (is_user_thread (t) && t->process == process)
+    thread_interrupt (t);
+}
+
+/* Called on the way back to user mode.  If the running thread is
+   a user thread whose process is exiting, exits it instead. */
+void
+process_check_dying (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (is_user_thread (cur) && cur->process->dying)
+    {
+      cur->exit_status = -1;
+      thread_exit ();
+    }
+}
+
 /* Free the current process's resources. */
 void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  struct list_elem *e;
   uint32_t *pd;
 
+  /* A user thread leaves the process's resources to the others,
+     and wakes the first thread if it is the last to go. */
+  if (is_user_thread (cur))
+    {
+      struct thread *process = cur->process;
+
+      cur->pagedir = NULL;
+      pagedir_activate (NULL);
+      old_level = intr_disable ();
+      process->stack_slots &= ~(1u << cur->stack_slot);
+      if (--process->thread_cnt == 0)
+        sema_up (&process->threads_done);
+      intr_set_level (old_level);
+      return;
+    }
+
+  /* The first thread makes the process's other threads exit,
+     waking those that are waiting, and waits for them to go.
+     Then it reaps those that were never joined. */
+  old_level = intr_disable ();
+  cur->dying = true;
+  thread_foreach (interrupt_sibling, cur);
+  while (cur->thread_cnt > 0)
+    sema_down (&cur->threads_done);
+  intr_set_level (old_level);
+  for (e = list_begin (&cur->child_list); e != list_end (&cur->child_list); )
+    {
+      struct thread *t = list_entry (e, struct thread, child_elem);
+
+      e = list_next (e);
+      if (is_user_thread (t))
+        {
+          list_remove (&t->child_elem);
+          sema_down (&t->exit_program);
+          thread_free (t);
+        }
+    }
+
+  /* Let asynchronous I/O into the process's memory finish. */
+  aio_exit (cur);
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -324,6 +606,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
   int i;
 
   /* Allocate and activate page directory. */
+  t->heap_start = t->heap_end = NULL;
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
@@ -402,6 +685,13 @@ load (const char *file_name, void (**eip) (void), void **esp)
               if (!load_segment (file, file_page, (void *) mem_page,
                                  read_bytes, zero_bytes, writable))
                 goto done;
+
+              /* The heap starts on the page after the highest
+                 segment. */
+              if ((uint8_t *) mem_page + read_bytes + zero_bytes
+                  > t->heap_start)
+                t->heap_start = t->heap_end
+                  = (uint8_t *) mem_page + read_bytes + zero_bytes;
             }
           else
             goto done;
@@ -426,8 +716,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
-static bool install_page (void *upage, void *kpage, bool writable);
-
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
 static bool
@@ -572,6 +860,64 @@ install_page (void *upage, void *kpage, bool writable)
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
 
+/* Unmaps and frees the user pages from START up to END, both
+   page-aligned, in the current process. */
+static void
+free_heap_pages (uint8_t *start, uint8_t *end)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *upage;
+
+  for (upage = start; upage < end; upage += PGSIZE)
+    {
+      void *kpage = pagedir_get_page (pd, upage);
+
+      ASSERT (kpage != NULL);
+      pagedir_clear_page (pd, upage);
+      palloc_free_page (kpage);
+    }
+}
+
+/* Moves the current process's program break, the end of its
+   heap, by INCREMENT bytes, which may be negative.  The heap
+   starts right after the executable's highest segment and may
+   grow up to HEAP_LIMIT, leaving room below for the stack.
+   Pages that become part of the heap are zeroed; pages that
+   leave it are freed.  Returns the old break, or a null pointer
+   if the heap can't grow (or shrink) that far. */
+void *
+process_sbrk (intptr_t increment)
+{
+  struct thread *t = process_of (thread_current ());
+  uint8_t *old_end = t->heap_end;
+  uint8_t *new_end = old_end + increment;
+  uint8_t *old_top = pg_round_up (old_end);
+  uint8_t *new_top = pg_round_up (new_end);
+  uint8_t *upage;
+
+  if (increment >= 0
+      ? new_end < old_end || new_end > (uint8_t *) HEAP_LIMIT
+      : new_end > old_end || new_end < t->heap_start)
+    return NULL;
+
+  for (upage = old_top; upage < new_top; upage += PGSIZE)
+    {
+      void *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (kpage == NULL || !install_page (upage, kpage, true))
+        {
+          palloc_free_page (kpage);
+          free_heap_pages (old_top, upage);
+          return NULL;
+        }
+    }
+  if (new_top < old_top)
+    aio_unmap (t, new_top, old_top);
+  free_heap_pages (new_top, old_top);
+
+  t->heap_end = new_end;
+  return old_end;
+}
+
 void
 argument_stack(char **parse ,int count ,void **esp)
 {
@@ -624,7 +970,7 @@ void
 clear_opened_filedesc(void)
 {
   int i;
-  struct thread *t = thread_current ();
+  struct thread *t = process_of (thread_current ());
 
   for(i=3; i<t->file_desc_size; ++i)
   {
@@ -633,11 +979,34 @@ clear_opened_filedesc(void)
 }
 
 
+/* Gives the current process its own reference to each pipe end
+   open in PARENT, under the same file descriptor.  Ordinary files
+   are not inherited.  This lets a process hand one end of a pipe
+   to a child it starts with exec(). */
+void
+process_inherit_pipes (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+  int fd;
+
+  parent = process_of (parent);
+  for (fd = 3; fd < parent->file_desc_size; fd++)
+    {
+      struct file *file = parent->file_desc[fd];
+      if (file != NULL && file_is_pipe (file))
+        {
+          t->file_desc[fd] = file_reopen (file);
+          if (t->file_desc[fd] != NULL && fd >= t->file_desc_size)
+            t->file_desc_size = fd + 1;
+        }
+    }
+}
+
 // search and get file struct by file descriptor
 struct file*
 process_get_file(int fd)
 {
-  struct thread *t = thread_current ();
+  struct thread *t = process_of (thread_current ());
   if(fd<0 || fd >= t->file_desc_size || t->file_desc[fd]==NULL)
     return NULL; // not found
 
@@ -650,7 +1019,7 @@ int
 process_add_file (struct file *f)
 {
   int fd = -1;
-  struct thread *t = thread_current ();
+  struct thread *t = process_of (thread_current ());
   //printf("process_add_file %d, %d\n", t->file_desc_size, MAX_FILE_DESC_COUNT);
   if(t->file_desc_size >= MAX_FILE_DESC_COUNT)
   {
@@ -670,7 +1039,7 @@ process_add_file (struct file *f)
 void
 process_close_file (int fd)
 {
-  struct thread *t = thread_current ();
+  struct thread *t = process_of (thread_current ());
   struct file *file = process_get_file(fd);
   if(file != NULL)
   {
@@ -690,7 +1059,7 @@ struct thread *get_child_process (int pid)
        e = list_next (e))
   {
     child = list_entry (e, struct thread, child_elem);
-    if (child->tid == pid)
+    if (child->tid == pid && !is_user_thread (child))
       return child;
   }
   return NULL;
@@ -711,7 +1080,7 @@ void remove_child_process (struct thread *cp)
     {
       e->prev->next = e->next;
       e->next->prev = e->prev;
-      palloc_free_page (cp);
+      thread_free (cp);
       break;
     }
   }
@@ -1,13 +1,33 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <stdint.h>
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Highest address that the heap may reach, leaving 8 MB for the
+   stack below PHYS_BASE. */
+#define HEAP_LIMIT ((uint8_t *) PHYS_BASE - 8 * 1024 * 1024)
+
+/* User threads.  A process may have up to USER_THREAD_MAX
+   threads besides its first.  Each gets a THREAD_STACK_SPAN-byte
+   slot below the first thread's stack, of which the top
+   THREAD_STACK_PAGES pages are mapped. */
+#define USER_THREAD_MAX 32
+#define THREAD_STACK_SPAN (64 * 1024)
+#define THREAD_STACK_PAGES 4
 
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
+void process_check_dying (void);
 void process_activate (void);
+struct thread *process_of (struct thread *);
 void clear_opened_filedesc(void);
+void process_inherit_pipes (struct thread *parent);
+void *process_sbrk (intptr_t increment);
+tid_t process_thread_create (void *eip, void *func, void *arg);
+int process_thread_join (tid_t);
 
 void argument_stack(char **parse ,int count ,void **esp);
 
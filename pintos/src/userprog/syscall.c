@@ -1,13 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include <threadstat.h>
 #include <console.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/synch.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/pipe.h"
 #include "devices/input.h"
+#include "userprog/aio.h"
+#include "userprog/futex.h"
 #include "userprog/process.h"
 #include "devices/shutdown.h"
 #include "filesys/filesys.h"
@@ -17,11 +22,14 @@
 static void syscall_handler (struct intr_frame *);
 bool user_mem_read(void *, void *, int);
 static int get_user(const uint8_t *);
+static void account_io (int number, int result);
 
 void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  futex_init ();
+  aio_init ();
 }
 
 /*
@@ -48,6 +56,8 @@ syscall_handler (struct intr_frame *f)
   esp = f->esp;
   printf("test0 %d\n", *esp);
   number = *esp;
+  if (number >= 0 && number < SYS_CNT)
+    thread_current ()->syscall_cnt[number]++;
   printf("test1\n");
   /* systemcall number is located in the top of user stack */
   esp += 4;
@@ -118,7 +128,79 @@ syscall_handler (struct intr_frame *f)
       close (ARG_INT);
       break;
 
+    case SYS_PIPE:
+      DECL_ARGS(1)
+      f->eax = pipe ((int *) ARG_INT);
+      break;
+
+    case SYS_SBRK:
+      DECL_ARGS(1)
+      f->eax = (uint32_t) sbrk (ARG_INT);
+      break;
+
+    case SYS_FUTEX_WAIT:
+      DECL_ARGS(2)
+      f->eax = futex_wait ((int *) ARG_INT, ARG_INT);
+      break;
+
+    case SYS_FUTEX_WAKE:
+      DECL_ARGS(2)
+      f->eax = futex_wake ((int *) ARG_INT, ARG_INT);
+      break;
+
+    case SYS_THREAD_CREATE:
+      DECL_ARGS(3)
+      f->eax = process_thread_create ((void *) ARG_INT, (void *) ARG_INT,
+                                      (void *) ARG_INT);
+      break;
+
+    case SYS_THREAD_JOIN:
+      DECL_ARGS(1)
+      f->eax = process_thread_join (ARG_INT);
+      break;
+
+    case SYS_COPY_FILE_RANGE:
+      DECL_ARGS(3)
+      f->eax = copy_file_range (ARG_INT, ARG_INT, ARG_UNSIGNED);
+      break;
+
+    case SYS_READV:
+      DECL_ARGS(3)
+      f->eax = readv (ARG_INT, (const struct iovec *) ARG_INT, ARG_INT);
+      break;
+
+    case SYS_WRITEV:
+      DECL_ARGS(3)
+      f->eax = writev (ARG_INT, (const struct iovec *) ARG_INT, ARG_INT);
+      break;
+
+    case SYS_FSYNC:
+      DECL_ARGS(1)
+      f->eax = fsync (ARG_INT);
+      break;
+
+    case SYS_IO_SETUP:
+      DECL_ARGS(1)
+      f->eax = aio_setup ((struct io_ring *) ARG_INT);
+      break;
+
+    case SYS_IO_SUBMIT:
+      DECL_ARGS(1)
+      f->eax = aio_submit (ARG_INT);
+      break;
+
+    case SYS_IO_WAIT:
+      DECL_ARGS(1)
+      f->eax = aio_wait (ARG_INT);
+      break;
+
+    case SYS_GETSTATS:
+      DECL_ARGS(2)
+      f->eax = getstats (ARG_INT, (struct thread_stat *) ARG_INT);
+      break;
+
   }
+  account_io (number, f->eax);
   printf("test3\n");
   if (arg)
     free (arg);
@@ -332,6 +414,277 @@ close (int fd)
 	process_close_file(fd);	
 }
 
+/* new anonymous pipe: read end fd to FDS[0], write end fd to FDS[1] */
+int
+pipe (int *fds)
+{
+  struct pipe *p;
+  struct file *rfile, *wfile;
+  int rfd, wfd;
+
+  check_address (fds);
+  check_address (fds + 1);
+
+  p = pipe_create (PIPE_PAGE_CNT);
+  if (p == NULL)
+    return -1;
+
+  /* Each open end holds a reference, so once either end is
+     open, closing the ends frees P. */
+  rfile = file_open_pipe (p, false);
+  if (rfile == NULL)
+    {
+      pipe_destroy (p);
+      return -1;
+    }
+  wfile = file_open_pipe (p, true);
+  if (wfile == NULL)
+    {
+      file_close (rfile);
+      return -1;
+    }
+
+  rfd = process_add_file (rfile);
+  wfd = process_add_file (wfile);
+  if (rfd < 0 || wfd < 0)
+    {
+      if (rfd < 0)
+        file_close (rfile);
+      else
+        process_close_file (rfd);
+      if (wfd < 0)
+        file_close (wfile);
+      else
+        process_close_file (wfd);
+      return -1;
+    }
+
+  fds[0] = rfd;
+  fds[1] = wfd;
+  return 0;
+}
+
+/* grow or shrink the heap by INCREMENT bytes: returns the old
+   break, or (void *) -1 on failure */
+void *
+sbrk (intptr_t increment)
+{
+  void *old_end = process_sbrk (increment);
+
+  return old_end != NULL ? old_end : (void *) -1;
+}
+
+/* copy the CNT-entry iovec array at UIOV into KIOV, checking
+   every buffer it names in one pass: returns the buffers' total
+   length, or -1 if CNT is out of range or the total does not fit
+   in an int */
+static int
+copy_in_iovec (struct iovec *kiov, const struct iovec *uiov, int cnt)
+{
+  int total = 0;
+  int i;
+
+  if (cnt < 0 || cnt > IOV_MAX)
+    return -1;
+  if (!user_mem_read ((void *) uiov, kiov, cnt * sizeof *kiov))
+    exit (-1);
+
+  for (i = 0; i < cnt; i++)
+    {
+      uint8_t *base = kiov[i].iov_base;
+      size_t len = kiov[i].iov_len;
+
+      if (len > (size_t) (INT32_MAX - total))
+        return -1;
+      if (len > 0)
+        {
+          check_address (base);
+          check_address (base + len - 1);
+          if (base + len < base)
+            exit (-1);
+        }
+      total += len;
+    }
+  return total;
+}
+
+/* read into the CNT buffers described by IOV, in order, as one
+   read: returns the number of bytes read */
+int
+readv (int fd, const struct iovec *uiov, int cnt)
+{
+  struct iovec iov[IOV_MAX];
+  struct file *file;
+  int total = copy_in_iovec (iov, uiov, cnt);
+  int i, ret = 0;
+
+  if (total < 0)
+    return -1;
+
+  if (fd == 0)
+    {
+      for (i = 0; i < cnt; i++)
+        {
+          size_t j;
+
+          for (j = 0; j < iov[i].iov_len; j++)
+            ((char *) iov[i].iov_base)[j] = input_getc ();
+          ret += iov[i].iov_len;
+        }
+      return ret;
+    }
+
+  file = process_get_file (fd);
+  if (file == NULL)
+    return 0;
+
+  /* Hold the file's lock across all the buffers, so that no
+     other read or write lands in between. */
+  file_lock (file);
+  for (i = 0; i < cnt; i++)
+    {
+      int n = file_read (file, iov[i].iov_base, iov[i].iov_len);
+      if (n > 0)
+        ret += n;
+      if (n != (int) iov[i].iov_len)
+        {
+          if (n < 0 && ret == 0)
+            ret = -1;
+          break;
+        }
+    }
+  file_unlock (file);
+
+  return ret;
+}
+
+/* write the CNT buffers described by IOV, in order, as one
+   write: returns the number of bytes written */
+int
+writev (int fd, const struct iovec *uiov, int cnt)
+{
+  struct iovec iov[IOV_MAX];
+  struct file *file;
+  int total = copy_in_iovec (iov, uiov, cnt);
+  int i, ret = 0;
+
+  if (total < 0)
+    return -1;
+
+  if (fd == 1)
+    {
+      putbufv (iov, cnt);
+      return total;
+    }
+
+  file = process_get_file (fd);
+  if (file == NULL)
+    return 0;
+
+  file_lock (file);
+  for (i = 0; i < cnt; i++)
+    {
+      int n = file_write (file, iov[i].iov_base, iov[i].iov_len);
+      if (n > 0)
+        ret += n;
+      if (n != (int) iov[i].iov_len)
+        {
+          if (n < 0 && ret == 0)
+            ret = -1;
+          break;
+        }
+    }
+  file_unlock (file);
+
+  return ret;
+}
+
+/* copy up to SIZE bytes from IN_FD to OUT_FD, at their current
+   positions, without passing through user memory: returns the
+   number of bytes copied, or -1 on error */
+int
+copy_file_range (int in_fd, int out_fd, unsigned size)
+{
+  struct file *in = process_get_file (in_fd);
+  struct file *out = process_get_file (out_fd);
+  struct file *first, *second;
+  int ret;
+
+  if (in == NULL || out == NULL || in == out)
+    return -1;
+
+  /* Lock the two files in a fixed order, so that copies in
+     opposite directions can't deadlock. */
+  first = in < out ? in : out;
+  second = in < out ? out : in;
+  file_lock (first);
+  file_lock (second);
+  ret = file_copy (out, in, size > INT32_MAX ? INT32_MAX : size);
+  file_unlock (second);
+  file_unlock (first);
+
+  return ret;
+}
+
+/* Waits until the file system changes made so far, including
+   the creation of the file open as FD, are committed to disk:
+   returns 0, or -1 if FD is not open.  File data is written
+   through, so this only matters for metadata. */
+int
+fsync (int fd)
+{
+  if (process_get_file (fd) == NULL)
+    return -1;
+  filesys_sync ();
+  return 0;
+}
+
+/* Copies the accounting for the thread with the lowest tid not
+   less than PID into *BUF: returns that thread's tid, or -1 if
+   there is none.  See thread_get_stats(). */
+int
+getstats (pid_t pid, struct thread_stat *buf)
+{
+  struct thread_stat st;
+  tid_t tid;
+
+  check_address (buf);
+  check_address ((char *) (buf + 1) - 1);
+
+  tid = thread_get_stats (pid, &st);
+  if (tid != TID_ERROR)
+    memcpy (buf, &st, sizeof st);
+  return tid;
+}
+
+/* Charges the bytes moved by system call NUMBER, which returned
+   RESULT, to the running thread. */
+static void
+account_io (int number, int result)
+{
+  struct thread *t = thread_current ();
+
+  if (result <= 0)
+    return;
+  switch (number)
+    {
+    case SYS_READ:
+    case SYS_READV:
+      t->read_bytes += result;
+      break;
+
+    case SYS_WRITE:
+    case SYS_WRITEV:
+      t->write_bytes += result;
+      break;
+
+    case SYS_COPY_FILE_RANGE:
+      t->read_bytes += result;
+      t->write_bytes += result;
+      break;
+    }
+}
+
 pid_t exec (const char *cmd_line)
 {
   struct thread *t = thread_current ();
@@ -1,6 +1,11 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <iovec.h>
+#include <stdint.h>
+
+struct thread_stat;
+
 typedef int pid_t;
 
 void syscall_init (void);
@@ -18,6 +23,13 @@ int write(int fd, void *buffer, unsigned size);
 void seek (int fd , unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+int pipe (int *fds);
+void *sbrk (intptr_t increment);
+int copy_file_range (int in_fd, int out_fd, unsigned size);
+int readv (int fd, const struct iovec *iov, int cnt);
+int writev (int fd, const struct iovec *iov, int cnt);
+int fsync (int fd);
+int getstats (pid_t pid, struct thread_stat *buf);
 
 // assignment2: system call
 
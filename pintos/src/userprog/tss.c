@@ -2,6 +2,8 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -44,6 +46,9 @@
        stack pointer to point to the new thread's kernel stack.
        (The call is in thread_schedule_tail() in thread.c.)
 
+   Each CPU needs a TSS of its own, because each CPU runs a
+   different thread.
+
    See [IA32-v3a] 6.2.1 "Task-State Segment (TSS)" for a
    description of the TSS.  See [IA32-v3a] 5.12.1 "Exception- or
    Interrupt-Handler Procedures" for a description of when and
@@ -72,7 +77,7 @@ struct tss
     uint16_t trace, bitmap;
   };
 
-/* Kernel TSS. */
+/* Kernel TSSes, one for each CPU, all in one page. */
 static struct tss *tss;
 
 /* Initializes the kernel TSS. */
@@ -82,25 +87,38 @@ tss_init (void)
   /* Our TSS is never used in a call gate or task gate, so only a
      few fields of it are ever referenced, and those are the only
      ones we initialize. */
+  int i;
+
+  ASSERT (CPU_MAX * sizeof *tss <= PGSIZE);
+
   tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
-  tss->ss0 = SEL_KDSEG;
-  tss->bitmap = 0xdfff;
+  for (i = 0; i < CPU_MAX; i++)
+    {
+      tss[i].ss0 = SEL_KDSEG;
+      tss[i].bitmap = 0xdfff;
+    }
   tss_update ();
 }
 
-/* Returns the kernel TSS. */
+/* Returns the kernel TSS for the CPU numbered CPU_ID. */
 struct tss *
-tss_get (void) 
+tss_get (int cpu_id) 
 {
   ASSERT (tss != NULL);
-  return tss;
+  ASSERT (cpu_id >= 0 && cpu_id < CPU_MAX);
+  return &tss[cpu_id];
 }
 
-/* Sets the ring 0 stack pointer in the TSS to point to the end
-   of the thread stack. */
+/* Sets the ring 0 stack pointer in the current CPU's TSS to
+   point to the end of the thread stack. */
 void
 tss_update (void) 
 {
+  enum intr_level old_level;
+
   ASSERT (tss != NULL);
-  tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
+
+  old_level = intr_disable ();
+  tss[cpu_current ()->id].esp0 = (uint8_t *) thread_current () + PGSIZE;
+  intr_set_level (old_level);
 }
@@ -272,15 +272,21 @@ sub make_kernel_command_line {
     return pack ("V a128", scalar (@args), $args);
 }
 
+# Bytes that copy_file() and write_zeros() move with each system call.
+# Scratch partitions of test inputs run to several megabytes, so this
+# is much bigger than a page to keep the number of calls down.
+our ($copy_chunk_size) = 64 * 1024;
+
 # copy_file($from_handle, $from_file_name, $to_handle, $to_file_name, $size)
 #
-# Copies $size bytes from $from_handle to $to_handle.
+# Copies $size bytes from $from_handle to $to_handle, in chunks of
+# $copy_chunk_size bytes.
 # $from_file_name and $to_file_name are used in error messages.
 sub copy_file {
     my ($from_handle, $from_file_name, $to_handle, $to_file_name, $size) = @_;
 
     while ($size > 0) {
-	my ($chunk_size) = 4096;
+	my ($chunk_size) = $copy_chunk_size;
 	$chunk_size = $size if $chunk_size > $size;
 	$size -= $chunk_size;
 
@@ -317,7 +323,7 @@ sub write_zeros {
     my ($handle, $file_name, $size) = @_;
 
     while ($size > 0) {
-	my ($chunk_size) = 4096;
+	my ($chunk_size) = $copy_chunk_size;
 	$chunk_size = $size if $chunk_size > $size;
 	$size -= $chunk_size;
 
@@ -0,0 +1,295 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <lz.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap.
+
+   swap_out() saves a page of memory and returns a slot from
+   which swap_in() later restores it.  A page goes to the first
+   of these places that will take it:
+
+   - A page of all zeros, common among freshly allocated pages
+     that were never written, is just marked as such.
+
+   - Otherwise, the page is compressed, and if it compresses to
+     no more than half its size and the compressed cache has
+     room, the compressed copy is kept in kernel memory.
+
+   - Otherwise, it is written to a page-sized run of sectors on
+     the swap device.
+
+   The first two cost no disk I/O in either direction, and
+   compressing or decompressing a page takes much less time than
+   moving its PAGE_SECTORS sectors to or from the disk.  Pages in
+   the cache stay there until swapped in or freed; the cache
+   never writes them back, so once it is full, further pages go
+   to disk until it drains.
+
+   Without a swap device, only the first two are available. */
+
+/* Sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Most bytes of compressed pages to keep in the cache. */
+#define CACHE_BYTES (256 * 1024)
+
+/* Largest compressed page worth caching.  malloc() rounds bigger
+   blocks up to a whole page, which would save nothing. */
+#define CACHE_MAX_PAGE (PGSIZE / 2)
+
+/* Slots beyond those backed by the swap device, enough for the
+   cache to fill with pages compressed 8:1, or for that many zero
+   pages. */
+#define EXTRA_SLOTS (CACHE_BYTES / PGSIZE * 8)
+
+/* Where a swapped-out page is. */
+enum slot_kind
+  {
+    SLOT_ZERO,                  /* Nowhere: it is all zeros. */
+    SLOT_CACHE,                 /* Compressed, in the cache. */
+    SLOT_DISK                   /* On the swap device. */
+  };
+
+/* A swapped-out page. */
+struct swap_slot
+  {
+    enum slot_kind kind;        /* Where the page is. */
+    uint8_t *data;              /* SLOT_CACHE: compressed page. */
+    size_t size;                /* SLOT_CACHE: bytes in DATA. */
+    size_t page;                /* SLOT_DISK: page on swap device. */
+  };
+
+/* Swap device, or a null pointer if there is none. */
+static struct block *swap_device;
+
+/* Slots, and a bitmap of those in use. */
+static struct swap_slot *slots;
+static struct bitmap *used_slots;
+
+/* Bitmap of pages in use on the swap device, if any. */
+static struct bitmap *used_pages;
+
+/* Bytes in the cache. */
+static size_t cache_bytes;
+
+/* Protects all of the above. */
+static struct lock swap_lock;
+
+/* Compressor buffers, and a lock that protects them. */
+static uint8_t compress_work[LZ_WORK_SIZE];
+static uint8_t compress_buf[CACHE_MAX_PAGE];
+static struct lock compress_lock;
+
+/* Statistics. */
+static unsigned zero_cnt;       /* Zero pages swapped out. */
+static unsigned cache_cnt;      /* Pages swapped out to the cache. */
+static unsigned disk_cnt;       /* Pages swapped out to disk. */
+static unsigned long long compressed_bytes;  /* Sum of cached sizes. */
+static unsigned reads_avoided;  /* Sectors swapped in from memory. */
+
+static bool is_zero_page (const void *);
+
+/* Sets up swapping, to the swap device if there is one. */
+void
+swap_init (void)
+{
+  size_t page_cnt = 0;
+  size_t slot_cnt;
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device != NULL)
+    {
+      page_cnt = block_size (swap_device) / PAGE_SECTORS;
+      used_pages = bitmap_create (page_cnt);
+      if (used_pages == NULL)
+        PANIC ("swap device bitmap creation failed");
+    }
+
+  slot_cnt = page_cnt + EXTRA_SLOTS;
+  slots = malloc (slot_cnt * sizeof *slots);
+  used_slots = bitmap_create (slot_cnt);
+  if (slots == NULL || used_slots == NULL)
+    PANIC ("swap slot table creation failed");
+
+  lock_init (&swap_lock);
+  lock_init (&compress_lock);
+}
+
+/* Saves the page at KPAGE.  Returns the slot to pass to
+   swap_in() or swap_free(), or SWAP_ERROR if swap is full. */
+swap_slot_t
+swap_out (const void *kpage)
+{
+  struct swap_slot s;
+  size_t slot, disk_page;
+
+  ASSERT (pg_ofs (kpage) == 0);
+
+  /* Decide where the page goes. */
+  s.data = NULL;
+  s.size = 0;
+  if (is_zero_page (kpage))
+    s.kind = SLOT_ZERO;
+  else
+    {
+      lock_acquire (&compress_lock);
+      s.size = lz_compress (compress_buf, sizeof compress_buf,
+                            kpage, PGSIZE, compress_work);
+      if (s.size > 0)
+        {
+          bool room;
+
+          lock_acquire (&swap_lock);
+          room = cache_bytes + s.size <= CACHE_BYTES;
+          if (room)
+            cache_bytes += s.size;
+          lock_release (&swap_lock);
+
+          if (room)
+            {
+              s.data = malloc (s.size);
+              if (s.data != NULL)
+                memcpy (s.data, compress_buf, s.size);
+              else
+                {
+                  lock_acquire (&swap_lock);
+                  cache_bytes -= s.size;
+                  lock_release (&swap_lock);
+                }
+            }
+        }
+      lock_release (&compress_lock);
+      s.kind = s.data != NULL ? SLOT_CACHE : SLOT_DISK;
+    }
+
+  /* Allocate a slot, and disk space if needed. */
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (used_slots, 0, 1, false);
+  disk_page = BITMAP_ERROR;
+  if (slot != BITMAP_ERROR && s.kind == SLOT_DISK)
+    {
+      disk_page = (used_pages != NULL
+                   ? bitmap_scan_and_flip (used_pages, 0, 1, false)
+                   : BITMAP_ERROR);
+      if (disk_page == BITMAP_ERROR)
+        {
+          bitmap_reset (used_slots, slot);
+          slot = BITMAP_ERROR;
+        }
+    }
+  if (slot == BITMAP_ERROR)
+    {
+      if (s.kind == SLOT_CACHE)
+        {
+          cache_bytes -= s.size;
+          free (s.data);
+        }
+      lock_release (&swap_lock);
+      return SWAP_ERROR;
+    }
+  s.page = disk_page;
+  slots[slot] = s;
+  if (s.kind == SLOT_ZERO)
+    zero_cnt++;
+  else if (s.kind == SLOT_CACHE)
+    {
+      cache_cnt++;
+      compressed_bytes += s.size;
+    }
+  else
+    disk_cnt++;
+  lock_release (&swap_lock);
+
+  if (s.kind == SLOT_DISK)
+    block_write_multiple (swap_device, disk_page * PAGE_SECTORS,
+                          PAGE_SECTORS, kpage);
+  return slot;
+}
+
+/* Restores the page saved in SLOT into KPAGE, and frees SLOT. */
+void
+swap_in (swap_slot_t slot, void *kpage)
+{
+  struct swap_slot *s = &slots[slot];
+  size_t size;
+
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (bitmap_test (used_slots, slot));
+
+  switch (s->kind)
+    {
+    case SLOT_ZERO:
+      memset (kpage, 0, PGSIZE);
+      break;
+
+    case SLOT_CACHE:
+      size = lz_decompress (kpage, PGSIZE, s->data, s->size);
+      ASSERT (size == PGSIZE);
+      break;
+
+    case SLOT_DISK:
+      block_read_multiple (swap_device, s->page * PAGE_SECTORS,
+                           PAGE_SECTORS, kpage);
+      break;
+    }
+
+  lock_acquire (&swap_lock);
+  if (s->kind != SLOT_DISK)
+    reads_avoided += PAGE_SECTORS;
+  lock_release (&swap_lock);
+  swap_free (slot);
+}
+
+/* Discards the page saved in SLOT. */
+void
+swap_free (swap_slot_t slot)
+{
+  struct swap_slot *s = &slots[slot];
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (used_slots, slot));
+  if (s->kind == SLOT_CACHE)
+    {
+      cache_bytes -= s->size;
+      free (s->data);
+    }
+  else if (s->kind == SLOT_DISK)
+    bitmap_reset (used_pages, s->page);
+  bitmap_reset (used_slots, slot);
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  unsigned permille = 0;
+
+  if (cache_cnt > 0)
+    permille = compressed_bytes * 1000 / ((unsigned long long) cache_cnt
+                                          * PGSIZE);
+  printf ("Swap: %u zero pages, %u pages compressed to %u.%u%%, "
+          "%u pages to disk, %u sector writes and %u reads avoided\n",
+          zero_cnt, cache_cnt, permille / 10, permille % 10, disk_cnt,
+          (zero_cnt + cache_cnt) * PAGE_SECTORS, reads_avoided);
+}
+
+/* Returns true if the page at KPAGE is all zeros. */
+static bool
+is_zero_page (const void *kpage)
+{
+  const uint32_t *p = kpage;
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *p; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
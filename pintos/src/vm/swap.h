@@ -0,0 +1,17 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Identifies a page that has been swapped out. */
+typedef size_t swap_slot_t;
+#define SWAP_ERROR SIZE_MAX
+
+void swap_init (void);
+swap_slot_t swap_out (const void *kpage);
+void swap_in (swap_slot_t, void *kpage);
+void swap_free (swap_slot_t);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */